@@ -0,0 +1,90 @@
+#include "state/atomic_state.hpp"
+#include "state/buffered_state.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+// thread 0 writes continuously, all other threads are readers,
+// reported are the rates of sets, successful loads and failed load attempts
+// (retries) for 1 to 64 readers
+
+namespace {
+
+template <size_t Bytes> struct Payload {
+  Payload() = default;
+  explicit Payload(uint64_t value) {
+    for (auto &v : values) {
+      v = value;
+    }
+  }
+
+  uint64_t values[Bytes / sizeof(uint64_t)]{};
+};
+
+} // namespace
+
+namespace traits {
+template <size_t Bytes>
+struct is_memcopyable<Payload<Bytes>> : public std::true_type {};
+} // namespace traits
+
+namespace {
+
+template <typename State> State &shared_state() {
+  static State state;
+  return state;
+}
+
+template <typename State> void BM_SingleWriterLoad(benchmark::State &state) {
+  auto &sut = shared_state<State>();
+  uint64_t sets = 0;
+  uint64_t loads = 0;
+  uint64_t retries = 0;
+
+  typename State::storage_t dest;
+  if (state.thread_index() == 0) {
+    for (auto _ : state) {
+      sut.set(++sets);
+    }
+  } else {
+    for (auto _ : state) {
+      while (!sut.try_load(&dest)) {
+        ++retries;
+      }
+      ++loads;
+      benchmark::DoNotOptimize(dest);
+    }
+  }
+
+  state.counters["sets"] = benchmark::Counter(sets, benchmark::Counter::kIsRate);
+  state.counters["loads"] =
+      benchmark::Counter(loads, benchmark::Counter::kIsRate);
+  state.counters["retries"] =
+      benchmark::Counter(retries, benchmark::Counter::kIsRate);
+}
+
+void readers(benchmark::internal::Benchmark *b) {
+  for (int readers = 1; readers <= 64; readers *= 2) {
+    b->Threads(readers + 1);
+  }
+  b->UseRealTime();
+}
+
+using Small = Payload<64>;
+using Large = Payload<4096>;
+
+BENCHMARK_TEMPLATE(BM_SingleWriterLoad, sw_atomic_state<Small>)
+    ->Apply(readers);
+BENCHMARK_TEMPLATE(BM_SingleWriterLoad, sw_buffered_state<Small, 3>)
+    ->Apply(readers);
+BENCHMARK_TEMPLATE(BM_SingleWriterLoad, sw_atomic_state<Large>)
+    ->Apply(readers);
+BENCHMARK_TEMPLATE(BM_SingleWriterLoad, sw_buffered_state<Large, 3>)
+    ->Apply(readers);
+BENCHMARK_TEMPLATE(BM_SingleWriterLoad, sw_buffered_state<Large, 4>)
+    ->Apply(readers);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include "monitoring/perf_counters.hpp"
+
+// hardware counters of the calling thread per iteration of a benchmark loop,
+// counters that are not permitted are not reported
+// (counters of several benchmark threads are summed up before the division)
+class benchmark_counters {
+public:
+  benchmark_counters() { m_counters.start(); }
+
+  void report(benchmark::State &state) {
+    m_counters.stop();
+    auto sample = m_counters.read();
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+      if (m_counters.available(i)) {
+        state.counters[m_counters.event(i).name] = benchmark::Counter(
+            double(sample.values[i]), benchmark::Counter::kAvgIterations);
+      }
+    }
+  }
+
+private:
+  monitor::perf_counters m_counters;
+};
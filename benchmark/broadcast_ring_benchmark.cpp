@@ -0,0 +1,130 @@
+#include "state/broadcast_ring.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// throughput: thread 0 pushes continuously, all other threads are polling
+// readers, reported are the rates of pushes, reads and lost messages
+// latency: round trip of a message between two threads with blocking reads
+
+namespace {
+
+template <size_t Bytes> struct Payload {
+  Payload() = default;
+  explicit Payload(uint64_t value) {
+    for (auto &v : values) {
+      v = value;
+    }
+  }
+
+  uint64_t values[Bytes / sizeof(uint64_t)]{};
+};
+
+} // namespace
+
+namespace traits {
+template <size_t Bytes>
+struct is_memcopyable<Payload<Bytes>> : public std::true_type {};
+} // namespace traits
+
+namespace {
+
+using Small = Payload<64>;
+using Large = Payload<1024>;
+
+template <typename Ring> Ring &shared_ring() {
+  static Ring ring;
+  return ring;
+}
+
+template <typename Ring> void BM_Push(benchmark::State &state) {
+  Ring ring;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    ring.push(++i);
+  }
+  benchmark::DoNotOptimize(ring.head());
+}
+
+template <typename Ring> void BM_Throughput(benchmark::State &state) {
+  auto &ring = shared_ring<Ring>();
+  uint64_t pushes = 0;
+  uint64_t reads = 0;
+  uint64_t lost = 0;
+
+  typename Ring::storage_t dest;
+  if (state.thread_index() == 0) {
+    for (auto _ : state) {
+      ring.push(++pushes);
+    }
+  } else {
+    auto reader = ring.attach();
+    for (auto _ : state) {
+      if (reader.try_read(&dest)) {
+        ++reads;
+      }
+      benchmark::DoNotOptimize(dest);
+    }
+    lost = reader.lost();
+  }
+
+  state.counters["pushes"] =
+      benchmark::Counter(pushes, benchmark::Counter::kIsRate);
+  state.counters["reads"] =
+      benchmark::Counter(reads, benchmark::Counter::kIsRate);
+  state.counters["lost"] = benchmark::Counter(lost, benchmark::Counter::kIsRate);
+}
+
+template <typename Ring> void BM_RoundTrip(benchmark::State &state) {
+  Ring ping;
+  Ring pong;
+  std::atomic<bool> done{false};
+  auto ping_reader = ping.attach();
+  auto pong_reader = pong.attach();
+
+  std::thread t([&]() {
+    typename Ring::storage_t dest;
+    auto &message = *reinterpret_cast<Small *>(&dest);
+    while (true) {
+      ping_reader.read(message);
+      if (done.load(std::memory_order_relaxed)) {
+        break;
+      }
+      pong.push(message);
+    }
+  });
+
+  Small message;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    ping.push(++i);
+    pong_reader.read(message);
+  }
+
+  done = true;
+  ping.push(0);
+  t.join();
+}
+
+void readers(benchmark::internal::Benchmark *b) {
+  for (int readers = 1; readers <= 8; readers *= 2) {
+    b->Threads(readers + 1);
+  }
+  b->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_Push, sw_broadcast_ring<Small, 1024, 16>);
+BENCHMARK_TEMPLATE(BM_Push, sw_broadcast_ring<Large, 1024, 16>);
+BENCHMARK_TEMPLATE(BM_Throughput, sw_broadcast_ring<Small, 1024, 16>)
+    ->Apply(readers);
+BENCHMARK_TEMPLATE(BM_Throughput, sw_broadcast_ring<Large, 1024, 16>)
+    ->Apply(readers);
+BENCHMARK_TEMPLATE(BM_RoundTrip, sw_broadcast_ring<Small, 64, 2>)
+    ->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
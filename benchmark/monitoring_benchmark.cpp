@@ -7,8 +7,11 @@
 #include "monitoring/api.hpp"
 #include "monitoring/macros.hpp"
 
+#include "benchmark_counters.hpp"
+
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -36,15 +39,21 @@ inline void busy_loop(std::chrono::nanoseconds time) {
 
 class BM_Monitoring : public benchmark::Fixture {
 public:
-  void SetUp(const ::benchmark::State &state) {
+  void SetUp(::benchmark::State &state) {
     tl_deadline_violation = false;
     START_THIS_THREAD_MONITORING;
     SET_MONITORING_HANDLER(handler);
+    m_counters = std::make_unique<benchmark_counters>();
   }
 
-  void TearDown(const ::benchmark::State &state) {
+  void TearDown(::benchmark::State &state) {
+    m_counters->report(state);
+    m_counters.reset();
     STOP_THIS_THREAD_MONITORING;
   }
+
+private:
+  std::unique_ptr<benchmark_counters> m_counters;
 };
 
 BENCHMARK_F(BM_Monitoring, SingleDeadline)(benchmark::State &state) {
@@ -128,6 +137,7 @@ static void BM_P_MultiDeadline(benchmark::State &state) {
   tl_deadline_violation = false;
   START_THIS_THREAD_MONITORING;
   SET_MONITORING_HANDLER(handler);
+  benchmark_counters counters;
 
   for (auto _ : state) {
     // ignore slight overhead of the loop
@@ -138,6 +148,7 @@ static void BM_P_MultiDeadline(benchmark::State &state) {
   }
   benchmark::DoNotOptimize(tl_deadline_violation);
   benchmark::ClobberMemory();
+  counters.report(state);
   STOP_THIS_THREAD_MONITORING;
 }
 
@@ -149,6 +160,7 @@ static void BM_P_MultiNestedDeadline(benchmark::State &state) {
   tl_deadline_violation = false;
   START_THIS_THREAD_MONITORING;
   SET_MONITORING_HANDLER(handler);
+  benchmark_counters counters;
 
   for (auto _ : state) {
     // ignore slight overhead of the loop
@@ -162,6 +174,7 @@ static void BM_P_MultiNestedDeadline(benchmark::State &state) {
   }
   benchmark::DoNotOptimize(tl_deadline_violation);
   benchmark::ClobberMemory();
+  counters.report(state);
   STOP_THIS_THREAD_MONITORING;
 }
 
@@ -173,6 +186,7 @@ static void BM_P_MultiDeadlineViolation(benchmark::State &state) {
   tl_deadline_violation = false;
   START_THIS_THREAD_MONITORING;
   SET_MONITORING_HANDLER(handler);
+  benchmark_counters counters;
 
   for (auto _ : state) {
     // ignore slight overhead of the loop
@@ -184,6 +198,7 @@ static void BM_P_MultiDeadlineViolation(benchmark::State &state) {
   }
   benchmark::DoNotOptimize(tl_deadline_violation);
   benchmark::ClobberMemory();
+  counters.report(state);
   STOP_THIS_THREAD_MONITORING;
 }
 
@@ -198,6 +213,7 @@ static void BM_MT_SingleDeadline(benchmark::State &state) {
   tl_deadline_violation = false;
   START_THIS_THREAD_MONITORING;
   SET_MONITORING_HANDLER(handler);
+  benchmark_counters counters;
 
   for (auto _ : state) {
     EXPECT_PROGRESS_IN(1000ms, 1);
@@ -206,6 +222,7 @@ static void BM_MT_SingleDeadline(benchmark::State &state) {
   }
 
   benchmark::ClobberMemory();
+  counters.report(state);
   STOP_THIS_THREAD_MONITORING;
 }
 
@@ -215,6 +232,7 @@ static void BM_MT_SingleDeadlineViolation(benchmark::State &state) {
   tl_deadline_violation = false;
   START_THIS_THREAD_MONITORING;
   SET_MONITORING_HANDLER(handler);
+  benchmark_counters counters;
 
   for (auto _ : state) {
     EXPECT_PROGRESS_IN(1ns, 1);
@@ -223,6 +241,7 @@ static void BM_MT_SingleDeadlineViolation(benchmark::State &state) {
   }
 
   benchmark::ClobberMemory();
+  counters.report(state);
   STOP_THIS_THREAD_MONITORING;
 }
 
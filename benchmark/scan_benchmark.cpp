@@ -0,0 +1,197 @@
+#include <benchmark/benchmark.h>
+
+#include "monitoring/api.hpp"
+#include "monitoring/macros.hpp"
+
+#include "benchmark_counters.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// cost of one scan of the active monitoring thread (check_deadlines), called
+// directly by the benchmark thread, the active monitoring is not started
+// the baseline for changes of the thread registry or the stack layout
+
+namespace {
+using namespace std::chrono_literals;
+
+// registered threads with deadline stacks of a given depth
+// idle threads block while the benchmark thread scans them, violating ones
+// are stalled past all their deadlines (the scan walks their whole stack),
+// churning ones push and pop a checkpoint on top of their stack in a loop
+class population {
+public:
+  population(uint32_t threads, uint32_t depth, uint32_t violating,
+             uint32_t churning) {
+    m_threads.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i) {
+      if (i < churning) {
+        m_threads.emplace_back(&population::churn, this, depth);
+      } else {
+        bool violate = i < churning + violating;
+        m_threads.emplace_back(&population::idle, this, depth, violate);
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condvar.wait(lock, [&]() { return m_ready == threads; });
+  }
+
+  ~population() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_condvar.notify_all();
+    m_running.store(false, std::memory_order_relaxed);
+    for (auto &t : m_threads) {
+      t.join();
+    }
+  }
+
+  // pushes and pops of the churning threads so far
+  uint64_t churn_ops() const { return m_ops.load(std::memory_order_relaxed); }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_condvar;
+  uint32_t m_ready{0};
+  bool m_stop{false};
+
+  std::atomic<bool> m_running{true};
+  std::atomic<uint64_t> m_ops{0};
+
+  std::vector<std::thread> m_threads;
+
+  void ready() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ++m_ready;
+    }
+    m_condvar.notify_all();
+  }
+
+  void push(uint32_t depth, monitor::time_unit_t budget) {
+    for (uint32_t i = 0; i < depth; ++i) {
+      EXPECT_PROGRESS_IN(budget, i + 1);
+    }
+  }
+
+  void pop(uint32_t depth) {
+    for (uint32_t i = 0; i < depth; ++i) {
+      CONFIRM_PROGRESS;
+    }
+  }
+
+  void idle(uint32_t depth, bool violate) {
+    START_THIS_THREAD_MONITORING;
+    push(depth, violate ? monitor::time_unit_t(0) : monitor::time_unit_t(1h));
+    ready();
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condvar.wait(lock, [&]() { return m_stop; });
+    }
+
+    pop(depth);
+    STOP_THIS_THREAD_MONITORING;
+  }
+
+  void churn(uint32_t depth) {
+    START_THIS_THREAD_MONITORING;
+    push(depth - 1, 1h);
+    ready();
+
+    uint64_t ops = 0;
+    while (m_running.load(std::memory_order_relaxed)) {
+      EXPECT_PROGRESS_IN(1h, depth);
+      CONFIRM_PROGRESS;
+      ops += 2;
+      if (ops % 1024 == 0) {
+        m_ops.fetch_add(1024, std::memory_order_relaxed);
+      }
+    }
+
+    pop(depth - 1);
+    STOP_THIS_THREAD_MONITORING;
+  }
+};
+
+// args: registered threads, stack depth, violating threads in percent,
+// churning threads (included in the registered threads)
+void BM_Scan(benchmark::State &state) {
+  auto threads = static_cast<uint32_t>(state.range(0));
+  auto depth = static_cast<uint32_t>(state.range(1));
+  auto violating = static_cast<uint32_t>(threads * state.range(2) / 100);
+  auto churning = static_cast<uint32_t>(state.range(3));
+
+  population p(threads, depth, violating, churning);
+  auto &instance = monitor::monitor_instance();
+
+  // the first scan detects (and records) the violations, later scans
+  // only walk the stacks of the violating threads
+  instance.check_deadlines(monitor::clock_t::now());
+
+  uint64_t entries = 0;
+  uint64_t aborted = 0;
+  auto ops = p.churn_ops();
+
+  benchmark_counters counters;
+  for (auto _ : state) {
+    auto min = instance.check_deadlines(monitor::clock_t::now());
+    benchmark::DoNotOptimize(min);
+    entries += instance.last_tick().entries_walked;
+    aborted += instance.last_tick().aborted_scans;
+  }
+  counters.report(state);
+
+  using benchmark::Counter;
+  // time per iteration is the time per tick (real time, like the rates)
+  state.counters["per_thread"] =
+      Counter(threads, Counter::kIsIterationInvariantRate | Counter::kInvert);
+  state.counters["entries"] = Counter(entries, Counter::kAvgIterations);
+  state.counters["aborted"] = Counter(aborted, Counter::kAvgIterations);
+  if (churning > 0) {
+    state.counters["churn"] = Counter(p.churn_ops() - ops, Counter::kIsRate);
+  }
+}
+
+// registered threads (at most MAX_THREADS)
+BENCHMARK(BM_Scan)
+    ->ArgNames({"threads", "depth", "violating", "churning"})
+    ->UseRealTime()
+    ->ArgsProduct({{1, 4, 16, 64, 256, 1024}, {1}, {0}, {0}});
+
+// stack depth, only walked for violating threads
+BENCHMARK(BM_Scan)
+    ->ArgNames({"threads", "depth", "violating", "churning"})
+    ->UseRealTime()
+    ->ArgsProduct({{64}, {1, 4, 16, 64}, {0, 100}, {0}});
+
+// violation fraction
+BENCHMARK(BM_Scan)
+    ->ArgNames({"threads", "depth", "violating", "churning"})
+    ->UseRealTime()
+    ->ArgsProduct({{256}, {8}, {0, 1, 10, 50, 100}, {0}});
+
+// concurrent pushes and pops (the snapshot of a thread changes during its
+// scan, i.e. the scan is aborted)
+BENCHMARK(BM_Scan)
+    ->ArgNames({"threads", "depth", "violating", "churning"})
+    ->UseRealTime()
+    ->ArgsProduct({{64}, {4}, {0}, {1, 4, 16}});
+
+} // namespace
+
+int main(int argc, char **argv) {
+  // no output per detected violation
+  monitor::monitor_instance().set_handler([](monitor::checkpoint &) {});
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include "state/single_wait.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// round trip wake latency of SingleWait/Notifier (ping pong between two
+// threads), the argument is the spin budget of the waiters (0 always parks)
+
+namespace {
+
+void BM_NotifyNoWaiter(benchmark::State &state) {
+  WaitState ws;
+  Notifier notifier(ws);
+  for (auto _ : state) {
+    notifier.notify();
+  }
+  benchmark::DoNotOptimize(ws.count());
+}
+
+void BM_RoundTrip(benchmark::State &state) {
+  uint32_t spin = state.range(0);
+  WaitState ping_state;
+  WaitState pong_state;
+  std::atomic<bool> done{false};
+
+  std::thread t([&]() {
+    SingleWait ping(ping_state, spin);
+    Notifier pong(pong_state);
+    while (true) {
+      ping.wait();
+      if (done.load(std::memory_order_relaxed)) {
+        break;
+      }
+      pong.notify();
+    }
+  });
+
+  Notifier ping(ping_state);
+  SingleWait pong(pong_state, spin);
+  for (auto _ : state) {
+    ping.notify();
+    pong.wait();
+  }
+
+  done = true;
+  ping.notify();
+  t.join();
+
+  state.counters["parked"] = benchmark::Counter(pong_state.parked());
+}
+
+BENCHMARK(BM_NotifyNoWaiter);
+BENCHMARK(BM_RoundTrip)
+    ->Arg(0)
+    ->Arg(16)
+    ->Arg(128)
+    ->Arg(1024)
+    ->Arg(16384)
+    ->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,164 @@
+// built twice, with and without MONITORING_OFF (see CMakeLists.txt), the
+// driver (workload_compare.cpp) runs both and reports the overhead
+
+#include "monitoring/api.hpp"
+#include "monitoring/macros.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// a pool of workers processing tasks, each task has two nested sections
+// whose lengths follow the distributions of statistics_main.cpp (scaled from
+// microseconds to nanoseconds), the budgets are violated occasionally
+//
+// usage: benchmark_workload [threads] [tasks]
+// prints the throughput and the task latency percentiles (one value per line)
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// statistics_main.cpp, in ns instead of us
+constexpr int A = 1000;
+constexpr int B = 10000;
+constexpr double MEAN = 5000;
+constexpr double STDDEV = 1000;
+
+// of the nested sections, the uniform one is close to its budget
+constexpr auto SECTION_BUDGET = 10000ns;
+constexpr auto TASK_BUDGET = 25000ns;
+// tasks with a section stalled beyond its budget
+constexpr double STALL_RATIO = 0.001;
+constexpr auto STALL = 20000ns;
+
+struct task {
+  std::chrono::nanoseconds first;
+  std::chrono::nanoseconds second;
+};
+
+std::vector<task> generate(uint32_t tasks) {
+  std::mt19937 gen(42);
+  std::normal_distribution<> normal(MEAN, STDDEV);
+  std::uniform_int_distribution<> uniform(A, B);
+  std::bernoulli_distribution stall(STALL_RATIO);
+
+  std::vector<task> result(tasks);
+  for (auto &t : result) {
+    t.first = std::chrono::nanoseconds(int64_t(std::max(0.0, normal(gen))));
+    t.second = std::chrono::nanoseconds(uniform(gen));
+    if (stall(gen)) {
+      t.second += STALL;
+    }
+  }
+  return result;
+}
+
+// the work is spinning, i.e. the monitoring overhead adds to it
+inline void busy_loop(std::chrono::nanoseconds time) {
+  auto timeout = monitor::clock_t::now() + time;
+  while (timeout > monitor::clock_t::now())
+    ;
+}
+
+class pool {
+public:
+  explicit pool(const std::vector<task> &tasks) : m_tasks(tasks) {}
+
+  void run(uint32_t threads) {
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; ++i) {
+      workers.emplace_back(&pool::work, this);
+    }
+    for (auto &w : workers) {
+      w.join();
+    }
+  }
+
+  const monitor::latency_histogram &latency() const { return m_latency; }
+
+private:
+  const std::vector<task> &m_tasks;
+  std::atomic<size_t> m_next{0};
+
+  std::mutex m_mutex;
+  monitor::latency_histogram m_latency;
+
+  void work() {
+    monitor::latency_histogram latency;
+    START_THIS_THREAD_MONITORING;
+
+    size_t i;
+    while ((i = m_next.fetch_add(1, std::memory_order_relaxed)) <
+           m_tasks.size()) {
+      auto &t = m_tasks[i];
+      auto start = monitor::clock_t::now();
+
+      EXPECT_PROGRESS_IN(TASK_BUDGET, 1);
+
+      EXPECT_PROGRESS_IN(SECTION_BUDGET, 2);
+      busy_loop(t.first);
+      CONFIRM_PROGRESS;
+
+      EXPECT_PROGRESS_IN(SECTION_BUDGET, 3);
+      busy_loop(t.second);
+      CONFIRM_PROGRESS;
+
+      CONFIRM_PROGRESS;
+
+      latency.record((monitor::clock_t::now() - start).count());
+    }
+
+    STOP_THIS_THREAD_MONITORING;
+    std::lock_guard<std::mutex> g(m_mutex);
+    m_latency.merge(latency);
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+  uint32_t tasks = 100000;
+  if (argc > 1 && std::atoi(argv[1]) > 0) {
+    threads = std::atoi(argv[1]);
+  }
+  if (argc > 2 && std::atoi(argv[2]) > 0) {
+    tasks = std::atoi(argv[2]);
+  }
+
+#ifndef MONITORING_OFF
+  // no output per violation
+  monitor::monitor_instance().set_handler([](monitor::checkpoint &) {});
+#endif
+
+  auto work = generate(tasks);
+  pool p(work);
+
+  START_ACTIVE_MONITORING(1ms);
+  auto start = monitor::clock_t::now();
+  p.run(threads);
+  std::chrono::duration<double> elapsed = monitor::clock_t::now() - start;
+  STOP_ACTIVE_MONITORING;
+
+  auto &latency = p.latency();
+#ifdef MONITORING_OFF
+  std::cout << "monitoring 0" << std::endl;
+#else
+  std::cout << "monitoring 1" << std::endl;
+#endif
+  std::cout << "threads " << threads << std::endl;
+  std::cout << "tasks " << tasks << std::endl;
+  std::cout << "throughput " << tasks / elapsed.count() << std::endl;
+  std::cout << "p50 " << latency.value_at_quantile(0.5) << std::endl;
+  std::cout << "p99 " << latency.value_at_quantile(0.99) << std::endl;
+  std::cout << "p999 " << latency.value_at_quantile(0.999) << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// runs the workload with and without monitoring (alternating, the median of
+// the runs counts) and reports the monitoring overhead in percent
+//
+// usage: benchmark_workload_compare [runs] [workload arguments...]
+// the paths of the workload executables are set by CMake
+
+#ifndef WORKLOAD_ON
+#define WORKLOAD_ON "./benchmark_workload"
+#endif
+#ifndef WORKLOAD_OFF
+#define WORKLOAD_OFF "./benchmark_workload_off"
+#endif
+
+namespace {
+
+using result = std::map<std::string, double>;
+
+// the workload prints one "key value" pair per line
+bool run(const std::string &command, result &values) {
+  auto pipe = popen(command.c_str(), "r");
+  if (!pipe) {
+    return false;
+  }
+  std::string output;
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), pipe)) {
+    output += buffer;
+  }
+  if (pclose(pipe) != 0) {
+    return false;
+  }
+
+  std::istringstream lines(output);
+  std::string key;
+  double value;
+  while (lines >> key >> value) {
+    values[key] = value;
+  }
+  return values.count("throughput") != 0;
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int runs = 5;
+  if (argc > 1 && std::atoi(argv[1]) > 0) {
+    runs = std::atoi(argv[1]);
+  }
+  std::string arguments;
+  for (int i = 2; i < argc; ++i) {
+    arguments += std::string(" ") + argv[i];
+  }
+
+  const std::vector<std::string> keys{"throughput", "p50", "p99", "p999"};
+  std::map<std::string, std::vector<double>> on;
+  std::map<std::string, std::vector<double>> off;
+
+  for (int i = 0; i < runs; ++i) {
+    result a;
+    result b;
+    if (!run(std::string(WORKLOAD_OFF) + arguments, a) ||
+        !run(std::string(WORKLOAD_ON) + arguments, b)) {
+      std::cerr << "WORKLOAD ERROR - running the workload failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (auto &key : keys) {
+      off[key].push_back(a[key]);
+      on[key].push_back(b[key]);
+    }
+  }
+
+  std::cout << std::left << std::setw(12) << "" << std::right << std::setw(14)
+            << "off" << std::setw(14) << "on" << std::setw(10) << "delta"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  for (auto &key : keys) {
+    auto a = median(off[key]);
+    auto b = median(on[key]);
+    auto delta = a != 0 ? (b - a) / a * 100 : 0;
+    std::cout << std::left << std::setw(12) << key << std::right
+              << std::setw(14) << a << std::setw(14) << b << std::setw(9)
+              << delta << "%" << std::endl;
+  }
+
+  // the loss of throughput
+  auto a = median(off["throughput"]);
+  auto b = median(on["throughput"]);
+  std::cout << "monitoring overhead " << (a - b) / a * 100 << "%" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#include "monitoring/flight_recorder.hpp"
+
+#include <iostream>
+#include <string>
+
+// prints the events recorded by monitor::record_flight, also after the
+// process was killed
+//
+// usage: flight_dump <file>
+
+void print(monitor::flight_recorder &recorder,
+           const monitor::flight_event &e) {
+  std::cout << "  " << e.time << " "
+            << (e.type == monitor::flight_event_type::expect ? "expect "
+                                                             : "confirm")
+            << " depth " << e.depth << " id " << e.id << " at ";
+  auto site = recorder.site(e.index);
+  if (site) {
+    std::cout << site->file << ":" << site->line << " " << site->function;
+  } else {
+    std::cout << "unregistered checkpoint";
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <file>" << std::endl;
+    return 1;
+  }
+
+  auto recorder = monitor::flight_recorder::open(argv[1]);
+  if (!recorder) {
+    std::cerr << "cannot read flight recorder file " << argv[1] << std::endl;
+    return 1;
+  }
+
+  auto &header = recorder->header();
+  std::cout << "process " << header.pid << " (" << header.process << ")"
+            << std::endl;
+
+  for (uint32_t i = 0; i < recorder->max_threads(); ++i) {
+    auto &ring = recorder->ring(i);
+    if (ring.head() == 0) {
+      continue;
+    }
+    auto events = ring.events();
+    std::cout << "thread " << ring.os_tid() << " (" << ring.head()
+              << " events)" << std::endl;
+    for (auto &e : events) {
+      print(*recorder, e);
+    }
+
+    auto active = monitor::in_progress(events);
+    if (!active.empty()) {
+      std::cout << " in progress:" << std::endl;
+      for (auto &e : active) {
+        print(*recorder, e);
+      }
+    }
+  }
+  return 0;
+}
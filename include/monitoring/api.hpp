@@ -1,17 +1,22 @@
 #pragma once
 
+#include "checkpoint_registry.hpp"
 #include "source_location.hpp"
 #include "thread_monitor.hpp"
 #include "thread_state.hpp"
 
 #include "report.hpp"
 #include "stack/allocator.hpp"
+#include "state/single_wait.hpp"
 #include "statistics.hpp"
 #include "time.hpp"
 
 #include <assert.h>
+#include <signal.h>
 #include <chrono>
 #include <ctime>
+#include <fstream>
+#include <string>
 
 namespace monitor {
 
@@ -61,34 +66,8 @@ void unset_this_thread_handler() {
   tl_state->unset_handler();
 }
 
-void expect_progress_in(time_unit_t timeout, const source_location &location) {
-  assert(is_monitored());
-
-  auto *entry = tl_stack_allocator.allocate();
-
-  // TODO: use monitoring fatal assert
-  if (!entry) {
-    std::cerr << "MONITORING ERROR - stack allocation error" << std::endl;
-    std::terminate();
-  }
-
-  // placement new
-  new (entry) stack_entry;
-
-  auto &data = entry->data;
-  data.location = location;
-  data.id = 0;
-  auto d = to_deadline(timeout);
-  data.deadline = d;
-  data.deadline_validator = d;
-  tl_state->deadlines.push(*entry);
-
-  // needed if we use some kind of adaptive deadline scheme
-  // this is too costly to be worth it
-  // monitor_instance().wake_up();
-}
-
 void expect_progress_in(time_unit_t timeout, checkpoint_id_t check_id,
+                        checkpoint_index_t check_index,
                         const source_location &location) {
   assert(is_monitored());
 
@@ -105,31 +84,108 @@ void expect_progress_in(time_unit_t timeout, checkpoint_id_t check_id,
   auto &data = entry->data;
   data.location = location;
   data.id = check_id;
-  auto d = to_deadline(timeout);
+  data.index = check_index;
+  // a calibrated or loaded budget overrides the literal one
+  auto budget = tl_state->monitor->budgets().budget(check_index, timeout);
+  auto d = to_deadline(budget);
   data.deadline = d;
   data.deadline_validator = d;
 
+  auto parent = tl_state->deadlines.top();
+  data.min_deadline = d;
+  if (parent && is_earlier(parent->data.min_deadline, d)) {
+    data.min_deadline = parent->data.min_deadline;
+  }
+
 #ifdef MONITORING_STATS
+  // nested in the checkpoint on top of the stack
+  data.path = tl_state->paths->child(parent ? parent->data.path : ROOT_PATH,
+                                     check_index);
+  data.children = 0;
   // TODO: taking the time twice is bad
   data.start = clock_t::now();
   // data.start = unow();
+#endif
+#ifdef MONITORING_STATS_CPU_TIME
+  data.cpu_start = thread_cpu_sample();
+#endif
+#ifdef MONITORING_STATS_PERF
+  // after the other samples, to count as little of the monitoring as possible
+  data.perf_start = tl_state->perf->read();
 #endif
   tl_state->deadlines.push(*entry);
+#ifdef MONITORING_MIN_DEADLINE
+  tl_state->snapshot.publish(data.min_deadline);
+  ++tl_state->depth;
+#else
+  tl_state->snapshot.publish(
+      {d, check_id, data.min_deadline, ++tl_state->depth});
+#endif
+  if (tl_state->shared) {
+    tl_state->shared->push(tl_state->depth, d, data.min_deadline, check_id,
+                           check_index);
+  }
+  if (tl_state->recorder) {
+    // the deadline is the time of the expect plus the budget
+    tl_state->recorder->record(flight_event_type::expect, d - budget.count(),
+                               check_id, check_index, tl_state->depth);
+  }
 
+  // needed if we use some kind of adaptive deadline scheme
   // this is too costly to be worth it
   // monitor_instance().wake_up();
 }
 
+// without a checkpoint site (not the macro API), statistics of all these
+// checkpoints are gathered together
+void expect_progress_in(time_unit_t timeout, checkpoint_id_t check_id,
+                        const source_location &location) {
+  expect_progress_in(timeout, check_id, UNREGISTERED_CHECKPOINT, location);
+}
+
+void expect_progress_in(time_unit_t timeout, const source_location &location) {
+  expect_progress_in(timeout, 0, UNREGISTERED_CHECKPOINT, location);
+}
+
+// after a pop, the thread is the only writer of its stack
+void publish_top() {
+  auto top = tl_state->deadlines.top();
+  --tl_state->depth;
+  if (top) {
+    auto &data = top->data;
+#ifdef MONITORING_MIN_DEADLINE
+    tl_state->snapshot.publish(data.min_deadline);
+#else
+    auto deadline = data.deadline.load(std::memory_order_relaxed);
+    tl_state->snapshot.publish(
+        {deadline, data.id, data.min_deadline, tl_state->depth});
+#endif
+  } else {
+    tl_state->snapshot.clear();
+  }
+  if (tl_state->shared) {
+    tl_state->shared->pop(tl_state->depth, top ? top->data.min_deadline : 0);
+  }
+}
+
 void confirm_progress(const source_location &location) {
   assert(is_monitored());
+#ifdef MONITORING_STATS_PERF
+  auto perf_end = tl_state->perf->read();
+#endif
   auto now = clock_t::now();
   // auto now = unow();
   auto confirm_time = to_time_unit(now);
 
   auto entry = tl_state->deadlines.pop();
   assert(entry != nullptr);
+  publish_top();
 
   auto &data = entry->data;
+  if (tl_state->recorder) {
+    tl_state->recorder->record(flight_event_type::confirm, confirm_time,
+                               data.id, data.index, tl_state->depth + 1);
+  }
   auto deadline = data.deadline.load();
 
 // TODO: ifdefs are bad, refactor (we still want efficiency...)
@@ -144,9 +200,11 @@ void confirm_progress(const source_location &location) {
 #ifdef MONITORING_STATS
       exceeded = true;
 #endif
+      auto &monitor = monitor_instance();
+      monitor.count_passive_violation();
       self_report_violation(*tl_state, data, delta, location);
       // TODO: conditional
-      monitor_instance().invoke_handler(data);
+      monitor.invoke_handler(data);
     }
     // to avoid reporting of monitoring thread, note that the monitoring thread
     // increments the other variable
@@ -158,27 +216,57 @@ void confirm_progress(const source_location &location) {
   }
   // TODO: check and optimize difference
   auto runtime = now - data.start;
-  // TODO: clean duration logic
-  auto d = std::chrono::duration_cast<std::chrono::microseconds>(runtime);
-  // auto d = std::chrono::duration_cast<time_unit_t>(runtime);
-  stats_monitor::update(data.id, d.count(), exceeded);
+  auto d = std::chrono::duration_cast<time_unit_t>(runtime);
+  time_t inclusive = d.count();
+  time_t self = inclusive > data.children ? inclusive - data.children : 0;
+  tl_state->paths->update(data.path, inclusive, self);
+  auto parent = tl_state->deadlines.top();
+  if (parent) {
+    parent->data.children += inclusive;
+  }
+#ifdef MONITORING_STATS_PERF
+  perf_sample counted;
+  const perf_sample *perf_used = nullptr;
+  if (tl_state->perf->valid()) {
+    counted = perf_end - data.perf_start;
+    perf_used = &counted;
+  }
+#endif
+  // thread local, merged on demand (one write of the statistics)
+#if defined(MONITORING_STATS_CPU_TIME) && defined(MONITORING_STATS_PERF)
+  auto used = thread_cpu_sample() - data.cpu_start;
+  tl_state->stats->update(data.index, data.id, d.count(), exceeded, used,
+                          perf_used);
+#elif defined(MONITORING_STATS_CPU_TIME)
+  auto used = thread_cpu_sample() - data.cpu_start;
+  tl_state->stats->update(data.index, data.id, d.count(), exceeded, used);
+#elif defined(MONITORING_STATS_PERF)
+  tl_state->stats->update(data.index, data.id, d.count(), exceeded,
+                          perf_used);
+#else
+  tl_state->stats->update(data.index, data.id, d.count(), exceeded);
+#endif
 #endif
 
   // no need to call a dtor of a stack_entry
   tl_stack_allocator.deallocate(entry);
 }
 
-// TODO: implement and test
+// confirms progress at the end of the scope
 class guard {
 
 public:
   guard(time_unit_t timeout, checkpoint_id_t check_id,
-        const source_location &location) {
+        checkpoint_index_t check_index, const source_location &location) {
 
     m_location = location;
-    expect_progress_in(timeout, check_id, m_location);
+    expect_progress_in(timeout, check_id, check_index, m_location);
   }
 
+  guard(time_unit_t timeout, checkpoint_id_t check_id,
+        const source_location &location)
+      : guard(timeout, check_id, UNREGISTERED_CHECKPOINT, location) {}
+
   guard(guard &) = delete;
 
   ~guard() { confirm_progress(m_location); }
@@ -187,9 +275,132 @@ private:
   source_location m_location;
 };
 
+// blocking wait as a checkpoint of its own kind (see DEFINE_WAIT_SITE),
+// a wait that does not return within budget is a violation like any other
+WaitState::value_t monitored_wait(SingleWait &waitable, time_unit_t budget,
+                                  checkpoint_index_t index,
+                                  const source_location &location) {
+  expect_progress_in(budget, 0, index, location);
+  auto signal = waitable.wait();
+  confirm_progress(location);
+  return signal;
+}
+
+// the deadline is the timeout plus MONITORED_WAIT_SLACK_US, i.e. only a wait
+// that overshoots its timeout is a violation,
+// returns WaitState::WAITING on timeout
+WaitState::value_t monitored_wait_for(SingleWait &waitable, time_unit_t timeout,
+                                      checkpoint_index_t index,
+                                      const source_location &location) {
+  auto slack = std::chrono::microseconds(MONITORED_WAIT_SLACK_US);
+  expect_progress_in(timeout + slack, 0, index, location);
+  auto signal = waitable.wait_for(timeout);
+  confirm_progress(location);
+  return signal;
+}
+
+// the deadlines of the threads that start monitoring afterwards are visible
+// to an out-of-process watchdog (see watchdog_main.cpp)
+bool export_to_watchdog(
+    const std::string &name = shared_segment::default_name()) {
+  return monitor_instance().export_to_watchdog(name);
+}
+
+// the last events of the threads that start monitoring afterwards are kept
+// in the file, also if the process is killed (see flight_dump_main.cpp),
+// fails for fewer than 2 events per thread
+bool record_flight(const std::string &path,
+                   uint32_t events = FLIGHT_RECORDER_EVENTS) {
+  return monitor_instance().record_flight(path, events);
+}
+
+// budget table as written by save_budgets, returns false if the file
+// cannot be read
+bool load_budgets(const std::string &path) {
+  return monitor_instance().budgets().load(path);
+}
+
+bool save_budgets(const std::string &path) {
+  return monitor_instance().budgets().save(path);
+}
+
+void clear_budgets() { monitor_instance().budgets().clear(); }
+
+// replaces the whole budget table (unlike load_budgets), the table is
+// unchanged if the file cannot be read
+bool reload_budgets(const std::string &path) {
+  return monitor_instance().budgets().reload(path);
+}
+
+// the active monitoring thread reloads the budget file after the signal,
+// nothing but a flag is set in the signal handler
+bool reload_budgets_on_signal(const std::string &path, int signo = SIGHUP) {
+  monitor_instance().set_budget_file(path);
+  struct sigaction action {};
+  action.sa_handler = detail::request_budget_reload;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  return sigaction(signo, &action, nullptr) == 0;
+}
+
+budget_table_status budgets_status() {
+  return monitor_instance().budgets().status();
+}
+
+#ifdef MONITORING_STATS
+// e.g. at the end of a learning period, followed by save_budgets
+uint32_t calibrate_budgets(const calibration_config &config = {}) {
+  return monitor_instance().calibrate_budgets(config);
+}
+
+// keep recalibrating online within the bounds of the config
+// (requires active monitoring)
+void start_budget_adaptation(const calibration_config &config = {}) {
+  monitor_instance().start_budget_adaptation(config);
+}
+
+void stop_budget_adaptation() { monitor_instance().stop_budget_adaptation(); }
+
+// evaluated by the active monitoring thread
+void add_slo(const slo &objective) {
+  monitor_instance().slos().add(objective);
+}
+
+// called from the active monitoring thread if an SLO starts to alarm
+template <typename H> void set_slo_handler(H &handler) {
+  monitor_instance().slos().set_handler(handler);
+}
+
+void unset_slo_handler() { monitor_instance().slos().unset_handler(); }
+
+// self time of the checkpoint paths as folded stacks for flame graph tools,
+// e.g. flamegraph.pl
+bool write_folded_stacks(const std::string &path) {
+  auto profile = monitor_instance().collect_paths();
+  std::ofstream file(path, std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  write_folded(file, profile);
+  return bool(file.flush());
+}
+#endif
+
+// violations detected by the active monitoring thread, including the
+// scheduling state of the late thread
+std::vector<violation_record> recent_violations() {
+  return monitor_instance().recent_violations();
+}
+
+// statistics of the active monitoring thread itself
+monitor_stats get_monitor_stats() { return monitor_instance().self_stats(); }
+
+void print_monitor_stats() { monitor_instance().self_stats().print(); }
+
 void print_stats() {
 #ifdef MONITORING_STATS
-  stats_monitor::print();
+  auto stats = monitor_instance().collect_stats();
+  stats_monitor::print(stats);
 #endif
 }
 
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "checkpoint_registry.hpp"
+#include "state/atomic_state.hpp"
+#include "statistics.hpp"
+#include "time.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace monitor {
+
+// what the budget table was last reloaded from
+struct budget_table_status {
+  // number of reloads
+  uint64_t generation{0};
+  // sites with a budget
+  uint32_t entries{0};
+  // time units of clock_t
+  time_t reloaded_at{0};
+  char path[256]{};
+};
+
+} // namespace monitor
+
+namespace traits {
+template <>
+struct is_memcopyable<monitor::budget_table_status> : public std::true_type {};
+} // namespace traits
+
+namespace monitor {
+
+namespace detail {
+// set in the signal handler (lock-free and constant initialized)
+inline std::atomic<bool> budget_reload_requested{false};
+
+inline void request_budget_reload(int) {
+  budget_reload_requested.store(true, std::memory_order_relaxed);
+}
+} // namespace detail
+
+// budgets per checkpoint site which override the literal budgets in the code,
+// 0 means no override
+// the file format is one site per line, tab separated
+// <file> <line> <budget in time units> <function (informational)>
+class budget_table {
+public:
+  budget_table() : budget_table(checkpoint_registry::count()) {}
+
+  explicit budget_table(checkpoint_index_t size)
+      : m_size(size), m_budgets(std::make_unique<std::atomic<time_t>[]>(size)) {
+    clear();
+  }
+
+  budget_table(const budget_table &) = delete;
+
+  // hot path, one relaxed load
+  time_unit_t budget(checkpoint_index_t index, time_unit_t literal) {
+    if (index < m_size) {
+      auto b = m_budgets[index].load(std::memory_order_relaxed);
+      if (b != 0) {
+        return time_unit_t(b);
+      }
+    }
+    return literal;
+  }
+
+  time_t get(checkpoint_index_t index) {
+    return index < m_size ? m_budgets[index].load(std::memory_order_relaxed)
+                          : 0;
+  }
+
+  void set(checkpoint_index_t index, time_t budget) {
+    if (index < m_size) {
+      m_budgets[index].store(budget, std::memory_order_relaxed);
+    }
+  }
+
+  void clear() {
+    for (checkpoint_index_t i = 0; i < m_size; ++i) {
+      m_budgets[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  checkpoint_index_t size() { return m_size; }
+
+  // returns the number of sites with a budget, unknown sites are ignored
+  uint32_t read(std::istream &in) {
+    return parse(in, [this](checkpoint_index_t index, time_t budget) {
+      set(index, budget);
+    });
+  }
+
+  // replaces all budgets, sites without an entry fall back to their literal
+  // budget, the file is read completely before anything is changed
+  bool reload(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+      return false;
+    }
+    reload(file, path);
+    return true;
+  }
+
+  void reload(std::istream &in, const std::string &source = "") {
+    std::vector<time_t> budgets(m_size, 0);
+    auto n = parse(in, [&](checkpoint_index_t index, time_t budget) {
+      budgets[index] = budget;
+    });
+
+    std::lock_guard<std::mutex> g(m_reload_mutex);
+    for (checkpoint_index_t i = 0; i < m_size; ++i) {
+      m_budgets[i].store(budgets[i], std::memory_order_relaxed);
+    }
+
+    auto status = m_status.load();
+    ++status.generation;
+    status.entries = n;
+    status.reloaded_at = to_time_unit(clock_t::now());
+    std::strncpy(status.path, source.c_str(), sizeof(status.path) - 1);
+    status.path[sizeof(status.path) - 1] = 0;
+    m_status.set(status);
+  }
+
+  // consistent, even during a concurrent reload
+  budget_table_status status() { return m_status.load(); }
+
+  // all sites with an override
+  void write(std::ostream &out) {
+    out << "# file\tline\tbudget (time units)\tfunction\n";
+    for (checkpoint_index_t i = 0; i < m_size; ++i) {
+      auto b = get(i);
+      if (b == 0) {
+        continue;
+      }
+      auto &location = checkpoint_registry::location(i);
+      out << location.file << "\t" << location.line << "\t" << b << "\t"
+          << location.function << "\n";
+    }
+  }
+
+  bool load(const std::string &path, uint32_t *count = nullptr) {
+    std::ifstream file(path);
+    if (!file) {
+      return false;
+    }
+    auto n = read(file);
+    if (count) {
+      *count = n;
+    }
+    return true;
+  }
+
+  bool save(const std::string &path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    write(file);
+    return bool(file.flush());
+  }
+
+private:
+  checkpoint_index_t m_size;
+  std::unique_ptr<std::atomic<time_t>[]> m_budgets;
+
+  // reloads may come from the API and the monitoring thread (on a signal),
+  // but the status has a single writer
+  std::mutex m_reload_mutex;
+  sw_atomic_state<budget_table_status> m_status;
+
+  template <typename Apply> uint32_t parse(std::istream &in, Apply apply) {
+    uint32_t n = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      std::istringstream fields(line);
+      std::string file;
+      unsigned site_line;
+      time_t budget;
+      if (!std::getline(fields, file, '\t') || !(fields >> site_line) ||
+          !(fields >> budget)) {
+        continue;
+      }
+      auto index = find(file, site_line);
+      if (index < m_size) {
+        apply(index, budget);
+        ++n;
+      }
+    }
+    return n;
+  }
+
+  checkpoint_index_t find(const std::string &file, unsigned line) {
+    auto n = std::min(m_size, checkpoint_registry::count());
+    for (checkpoint_index_t i = 0; i < n; ++i) {
+      auto &location = checkpoint_registry::location(i);
+      if (location.line == line && file == location.file) {
+        return i;
+      }
+    }
+    return m_size;
+  }
+};
+
+// derives budgets from the observed runtime distribution,
+// budget = percentile * margin, limited to [min_budget, max_budget]
+struct calibration_config {
+  double percentile{99.9};
+  double margin{1.5};
+  time_unit_t min_budget{std::chrono::microseconds(1)};
+  time_unit_t max_budget{std::chrono::seconds(10)};
+  // sites with fewer runs keep their budget
+  uint64_t min_count{100};
+  // for online adaptation by the active monitoring thread
+  std::chrono::milliseconds interval{std::chrono::seconds(10)};
+};
+
+inline time_t derive_budget(const stats &s, const calibration_config &config) {
+  double b = double(s.percentile(config.percentile)) * config.margin;
+  b = std::max(b, double(config.min_budget.count()));
+  b = std::min(b, double(config.max_budget.count()));
+  return static_cast<time_t>(b);
+}
+
+// returns the number of calibrated sites
+inline uint32_t calibrate(budget_table &budgets, const stats_table &table,
+                          const calibration_config &config) {
+  uint32_t n = 0;
+  auto size = std::min<size_t>(table.size(), budgets.size());
+  for (checkpoint_index_t i = 0; i < size; ++i) {
+    auto &s = table[i];
+    if (s.count < config.min_count) {
+      continue;
+    }
+    budgets.set(i, derive_budget(s, config));
+    ++n;
+  }
+  return n;
+}
+
+} // namespace monitor
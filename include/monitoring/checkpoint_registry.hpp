@@ -0,0 +1,96 @@
+#pragma once
+
+#include "source_location.hpp"
+#include "types.hpp"
+
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+namespace monitor {
+
+// what a site measures, blocking waits are kept apart from the work
+// sections in the statistics
+enum class checkpoint_kind : uint8_t { progress, wait };
+
+inline const char *to_string(checkpoint_kind kind) {
+  return kind == checkpoint_kind::wait ? "wait" : "progress";
+}
+
+// checkpoints used with the function API (no static site) share this index
+constexpr checkpoint_index_t UNREGISTERED_CHECKPOINT =
+    std::numeric_limits<checkpoint_index_t>::max();
+
+// all checkpoint sites (EXPECT_PROGRESS_IN etc. in the code) of the binary,
+// each site registers itself during static initialization and gets a dense
+// index, i.e. the complete set of sites is known when main starts
+// (including the sites that are never reached)
+class checkpoint_registry {
+public:
+  // not thread-safe, but only called during static initialization
+  static checkpoint_index_t
+  add(const source_location &location,
+      checkpoint_kind kind = checkpoint_kind::progress) {
+    auto &sites = instance();
+    sites.push_back(location);
+    kinds().push_back(kind);
+    return static_cast<checkpoint_index_t>(sites.size() - 1);
+  }
+
+  static checkpoint_index_t count() {
+    return static_cast<checkpoint_index_t>(instance().size());
+  }
+
+  static const source_location &location(checkpoint_index_t index) {
+    return instance()[index];
+  }
+
+  static checkpoint_kind kind(checkpoint_index_t index) {
+    return kinds()[index];
+  }
+
+private:
+  static std::vector<source_location> &instance() {
+    static std::vector<source_location> sites;
+    return sites;
+  }
+
+  static std::vector<checkpoint_kind> &kinds() {
+    static std::vector<checkpoint_kind> kinds;
+    return kinds;
+  }
+};
+
+// Tag is a unique local type per site (see DEFINE_CHECKPOINT_SITE),
+// the index is initialized before main like any other global
+template <typename Tag>
+struct checkpoint_site {
+  static const checkpoint_index_t index;
+};
+
+template <typename Tag>
+const checkpoint_index_t checkpoint_site<Tag>::index =
+    checkpoint_registry::add(Tag::location(), Tag::kind());
+
+} // namespace monitor
+
+// defines a local type name with a static index() function which returns the
+// dense index of the site, the hot path only loads a global constant
+#define DEFINE_CHECKPOINT_SITE(name)                                           \
+  DEFINE_CHECKPOINT_SITE_IMPL(name, monitor::checkpoint_kind::progress)
+
+// a site of a monitored blocking wait
+#define DEFINE_WAIT_SITE(name)                                                 \
+  DEFINE_CHECKPOINT_SITE_IMPL(name, monitor::checkpoint_kind::wait)
+
+#define DEFINE_CHECKPOINT_SITE_IMPL(name, site_kind)                           \
+  static constexpr const char *name##_function = __func__;                     \
+  struct name {                                                                \
+    static source_location location() {                                        \
+      return source_location{__FILE__, __LINE__, name##_function};             \
+    }                                                                          \
+    static monitor::checkpoint_kind kind() { return site_kind; }               \
+    static monitor::checkpoint_index_t index() {                               \
+      return monitor::checkpoint_site<name>::index;                            \
+    }                                                                          \
+  }
@@ -10,12 +10,67 @@
 
 // #define DEADLINE_VIOLATION_OUTPUT_ON
 
-// activation will kill performance due to map access under mutex!
-// statistic tracking must be refactored to work mostly local
+// the active monitoring thread reads the kernel scheduling state of a late
+// thread (/proc) into the violation record (linux only), after the scan and
+// the handlers, about SCHED_STATE_SAMPLE_US per detected violation
+// #define MONITORING_SCHED_STATE
+
+// each thread publishes only the earliest deadline of its active checkpoints
+// (a single atomic instead of the seqlock snapshot of the innermost one),
+// the monitoring thread checks a thread with a single load
+// #define MONITORING_MIN_DEADLINE
+
+// statistics are gathered thread locally and merged on demand,
+// the cost is mainly the additional time measurement
 // #define MONITORING_STATS
 
+// statistics additionally attribute the runtime of the sections to CPU time
+// and context switches (one getrusage call at expect and at confirm each)
+// #define MONITORING_STATS_CPU_TIME
+
+// statistics additionally count the instructions and cache misses of the
+// sections (hardware counters, one read system call at expect and at confirm
+// each, the counts are 0 if perf_event_open is not permitted)
+// #define MONITORING_STATS_PERF
+
+#if defined(MONITORING_STATS_CPU_TIME) && !defined(MONITORING_STATS)
+#define MONITORING_STATS
+#endif
+
+#if defined(MONITORING_STATS_PERF) && !defined(MONITORING_STATS)
+#define MONITORING_STATS
+#endif
+
 namespace monitor {
 
 constexpr uint32_t MAX_THREADS = 1024;
 
+// the most recent violations detected by the monitoring thread are kept
+constexpr uint32_t MAX_VIOLATION_RECORDS = 64;
+// to distinguish running from runnable threads
+constexpr uint32_t SCHED_STATE_SAMPLE_US = 200;
+
+// sliding windows of the statistics (rotated by the active monitoring thread),
+// 300 buckets of 1s each, i.e. windows up to 5 minutes
+constexpr uint32_t STATS_WINDOW_BUCKETS = 300;
+constexpr uint32_t STATS_WINDOW_RESOLUTION_MS = 1000;
+
+// distinct paths of nested checkpoints per thread (for self and inclusive
+// time), further paths (and the paths nested in them) are gathered together
+constexpr uint32_t STATS_MAX_PATHS = 1024;
+
+// the deadline of a monitored timed wait is its timeout plus this slack
+// (wake-up latency of the futex and scheduling delay, well above the jitter)
+constexpr uint32_t MONITORED_WAIT_SLACK_US = 10000;
+
+// out-of-process watchdog (see export_to_watchdog), mirrored nesting levels
+// per thread, maximum length of the site names and name prefix of the
+// shared memory segments
+constexpr uint32_t WATCHDOG_MAX_DEPTH = 8;
+constexpr uint32_t WATCHDOG_SITE_CHARS = 96;
+constexpr const char *WATCHDOG_SEGMENT_PREFIX = "/monitor.";
+
+// events per thread kept by the flight recorder (see record_flight)
+constexpr uint32_t FLIGHT_RECORDER_EVENTS = 256;
+
 }
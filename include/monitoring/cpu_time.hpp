@@ -0,0 +1,97 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <chrono>
+#include <iostream>
+#include <stdint.h>
+
+namespace monitor {
+
+// resource usage of the calling thread so far,
+// a single system call (getrusage) instead of reading the thread CPU clock
+// and the context switches separately, the CPU time has microsecond
+// resolution
+struct cpu_sample {
+  // user and system time in time units
+  time_t cpu_time{0};
+  uint64_t voluntary_switches{0};
+  uint64_t involuntary_switches{0};
+};
+
+inline time_t from_timeval(const timeval &tv) {
+  auto d =
+      std::chrono::seconds(tv.tv_sec) + std::chrono::microseconds(tv.tv_usec);
+  return std::chrono::duration_cast<time_unit_t>(d).count();
+}
+
+inline cpu_sample thread_cpu_sample() {
+  cpu_sample result;
+  rusage usage;
+  if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+    result.cpu_time =
+        from_timeval(usage.ru_utime) + from_timeval(usage.ru_stime);
+    result.voluntary_switches = usage.ru_nvcsw;
+    result.involuntary_switches = usage.ru_nivcsw;
+  }
+  return result;
+}
+
+// usage between two samples of the same thread
+inline cpu_sample operator-(const cpu_sample &end, const cpu_sample &start) {
+  cpu_sample result;
+  result.cpu_time = end.cpu_time - start.cpu_time;
+  result.voluntary_switches = end.voluntary_switches - start.voluntary_switches;
+  result.involuntary_switches =
+      end.involuntary_switches - start.involuntary_switches;
+  return result;
+}
+
+// where the (wall) time of the runs went,
+// off-CPU time means the thread was preempted (involuntary switches,
+// CPU contention) or blocked (voluntary switches, e.g. I/O or locks)
+struct cpu_attribution {
+  uint64_t count{0};
+  uint64_t runtime{0};
+  uint64_t cpu_time{0};
+  uint64_t voluntary_switches{0};
+  uint64_t involuntary_switches{0};
+
+  void update(time_t wall_time, const cpu_sample &used) {
+    ++count;
+    runtime += wall_time;
+    cpu_time += used.cpu_time;
+    voluntary_switches += used.voluntary_switches;
+    involuntary_switches += used.involuntary_switches;
+  }
+
+  void merge(const cpu_attribution &other) {
+    count += other.count;
+    runtime += other.runtime;
+    cpu_time += other.cpu_time;
+    voluntary_switches += other.voluntary_switches;
+    involuntary_switches += other.involuntary_switches;
+  }
+
+  // the resolution of the CPU time is coarser than that of the runtime
+  uint64_t off_cpu_time() const {
+    return runtime > cpu_time ? runtime - cpu_time : 0;
+  }
+
+  // means per run
+  void print(const char *name) const {
+    if (count == 0) {
+      return;
+    }
+    std::cout << name << " : on-CPU " << double(cpu_time) / count
+              << " off-CPU " << double(off_cpu_time()) / count
+              << " voluntary switches " << double(voluntary_switches) / count
+              << " involuntary switches "
+              << double(involuntary_switches) / count << std::endl;
+  }
+};
+
+} // namespace monitor
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "statistics.hpp"
+#include "thread_monitor.hpp"
+
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace monitor {
+
+enum class metrics_format {
+  // node exporter textfile collector
+  prometheus,
+  // served via the unix domain socket
+  openmetrics
+};
+
+namespace metrics {
+
+inline double to_seconds(uint64_t time_units) {
+  using period = time_unit_t::period;
+  return double(time_units) * period::num / period::den;
+}
+
+inline std::string escape(const char *value) {
+  std::string result;
+  for (; value && *value; ++value) {
+    switch (*value) {
+    case '\\':
+      result += "\\\\";
+      break;
+    case '"':
+      result += "\\\"";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    default:
+      result += *value;
+    }
+  }
+  return result;
+}
+
+inline void type(std::ostream &out, const char *name, const char *type,
+                 const char *help, metrics_format format) {
+  // prometheus text format expects the full name of counters
+  bool counter = std::strcmp(type, "counter") == 0;
+  const char *suffix =
+      counter && format == metrics_format::prometheus ? "_total" : "";
+  out << "# TYPE " << name << suffix << " " << type << "\n";
+  out << "# HELP " << name << suffix << " " << help << "\n";
+}
+
+inline void labels(std::ostream &out, const stats &s) {
+  out << "{kind=\"" << to_string(s.kind) << "\",";
+  if (s.location.file) {
+    out << "file=\"" << escape(s.location.file) << "\",line=\""
+        << s.location.line << "\",function=\""
+        << escape(s.location.function) << "\",id=\"" << s.id << "\"";
+  } else {
+    out << "file=\"unregistered\",line=\"0\",function=\"\",id=\"0\"";
+  }
+}
+
+} // namespace metrics
+
+// writes a snapshot in the Prometheus/OpenMetrics text format
+inline void write_metrics(std::ostream &out, const stats_table &table,
+                          const monitor_health &health,
+                          metrics_format format = metrics_format::openmetrics) {
+  using namespace metrics;
+
+  type(out, "monitor_registered_threads", "gauge",
+       "Threads currently registered for monitoring.", format);
+  out << "monitor_registered_threads " << health.registered_threads << "\n";
+
+  type(out, "monitor_active", "gauge",
+       "Whether the active monitoring thread is running.", format);
+  out << "monitor_active " << (health.active ? 1 : 0) << "\n";
+
+  type(out, "monitor_detected_violations", "counter",
+       "Deadline violations by detecting party.", format);
+  out << "monitor_detected_violations_total{detector=\"active\"} "
+      << health.active_violations << "\n";
+  out << "monitor_detected_violations_total{detector=\"passive\"} "
+      << health.passive_violations << "\n";
+
+  if (!table.empty()) {
+    type(out, "monitor_checkpoint_runs", "counter",
+         "Completed runs of a checkpoint section.", format);
+    for (auto &s : table) {
+      out << "monitor_checkpoint_runs_total";
+      labels(out, s);
+      out << "} " << s.count << "\n";
+    }
+
+    type(out, "monitor_checkpoint_violations", "counter",
+         "Runs of a checkpoint section that exceeded the time budget.",
+         format);
+    for (auto &s : table) {
+      out << "monitor_checkpoint_violations_total";
+      labels(out, s);
+      out << "} " << s.violations << "\n";
+    }
+
+    type(out, "monitor_checkpoint_duration_seconds", "summary",
+         "Runtime of a checkpoint section.", format);
+    const std::pair<const char *, double> quantiles[] = {
+        {"0.5", 50}, {"0.9", 90}, {"0.99", 99}, {"0.999", 99.9}, {"1", 100}};
+
+    for (auto &s : table) {
+      for (auto &q : quantiles) {
+        out << "monitor_checkpoint_duration_seconds";
+        labels(out, s);
+        out << ",quantile=\"" << q.first << "\"} "
+            << to_seconds(s.count > 0 ? s.percentile(q.second) : 0) << "\n";
+      }
+      out << "monitor_checkpoint_duration_seconds_sum";
+      labels(out, s);
+      out << "} " << to_seconds(s.sum) << "\n";
+      out << "monitor_checkpoint_duration_seconds_count";
+      labels(out, s);
+      out << "} " << s.count << "\n";
+    }
+  }
+
+  if (format == metrics_format::openmetrics) {
+    out << "# EOF\n";
+  }
+}
+
+// periodically takes a snapshot of the statistics and the monitor health
+// and publishes it either as a node exporter textfile (atomically replaced)
+// or via a unix domain socket (HTTP response with OpenMetrics text),
+// the snapshot only competes with thread registration for a lock and never
+// blocks the monitored threads
+class stats_exporter {
+public:
+  using duration_t = std::chrono::milliseconds;
+
+  stats_exporter(thread_monitor &monitor) : m_monitor(monitor) {}
+
+  stats_exporter(const stats_exporter &) = delete;
+
+  ~stats_exporter() { stop(); }
+
+  bool start_textfile(const std::string &path, duration_t interval) {
+    if (m_running) {
+      return false;
+    }
+    m_path = path;
+    m_interval = interval;
+    m_format = metrics_format::prometheus;
+    m_running = true;
+    m_thread = std::thread(&stats_exporter::loop, this);
+    return true;
+  }
+
+  bool start_socket(const std::string &path, duration_t interval) {
+    if (m_running) {
+      return false;
+    }
+    m_socket = listen(path);
+    if (m_socket < 0) {
+      std::cerr << "MONITORING ERROR - cannot listen on " << path
+                << std::endl;
+      return false;
+    }
+    m_path = path;
+    m_interval = interval;
+    m_format = metrics_format::openmetrics;
+    m_running = true;
+    m_thread = std::thread(&stats_exporter::loop, this);
+    return true;
+  }
+
+  void stop() {
+    if (m_running) {
+      m_running = false;
+      m_thread.join();
+      if (m_socket >= 0) {
+        close(m_socket);
+        unlink(m_path.c_str());
+        m_socket = -1;
+      }
+    }
+  }
+
+  // the most recent snapshot
+  std::string text() {
+    std::lock_guard<std::mutex> g(m_mutex);
+    return m_text;
+  }
+
+  // take a snapshot now, independent of the interval
+  void update() {
+    std::ostringstream out;
+#ifdef MONITORING_STATS
+    auto table = m_monitor.collect_stats();
+#else
+    stats_table table;
+#endif
+    write_metrics(out, table, m_monitor.health(), m_format);
+
+    std::lock_guard<std::mutex> g(m_mutex);
+    m_text = out.str();
+  }
+
+private:
+  // bounds the reaction time to stop
+  static constexpr int MAX_POLL_MS = 100;
+
+  thread_monitor &m_monitor;
+  std::thread m_thread;
+  std::atomic_bool m_running{false};
+
+  std::string m_path;
+  duration_t m_interval{1000};
+  metrics_format m_format{metrics_format::openmetrics};
+  int m_socket{-1};
+
+  std::mutex m_mutex;
+  std::string m_text;
+
+  void loop() {
+    auto next = clock_t::now();
+    while (m_running) {
+      auto now = clock_t::now();
+      if (now >= next) {
+        update();
+        if (m_socket < 0) {
+          write_textfile();
+        }
+        next = now + m_interval;
+      }
+
+      auto remaining =
+          std::chrono::duration_cast<duration_t>(next - clock_t::now());
+      // overdue if the update took longer than the interval
+      int timeout = std::max<int>(
+          0, std::min<int>(MAX_POLL_MS, remaining.count() + 1));
+
+      if (m_socket < 0) {
+        poll(nullptr, 0, timeout);
+        continue;
+      }
+
+      pollfd fd{m_socket, POLLIN, 0};
+      if (poll(&fd, 1, timeout) > 0 && (fd.revents & POLLIN)) {
+        serve();
+      }
+    }
+  }
+
+  bool write_textfile() {
+    // written completely before it replaces the old file (atomic rename)
+    auto tmp = m_path + ".tmp." + std::to_string(getpid());
+    {
+      std::ofstream file(tmp, std::ios::trunc);
+      if (!file) {
+        return false;
+      }
+      file << text();
+      if (!file.flush()) {
+        return false;
+      }
+    }
+    return rename(tmp.c_str(), m_path.c_str()) == 0;
+  }
+
+  static int listen(const std::string &path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+      return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return -1;
+    }
+    // stale socket of a previous run
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, 8) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // answer any request with the current snapshot and close the connection
+  void serve() {
+    int fd = accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+
+    // the request itself is irrelevant, read what is available
+    char buffer[1024];
+    pollfd request{fd, POLLIN, 0};
+    if (poll(&request, 1, MAX_POLL_MS) > 0) {
+      auto n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+      (void)n;
+    }
+
+    auto body = text();
+    std::string response =
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: application/openmetrics-text; version=1.0.0; "
+        "charset=utf-8\r\n"
+        "Content-Length: " +
+        std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    const char *p = response.data();
+    size_t remaining = response.size();
+    while (remaining > 0) {
+      auto n = send(fd, p, remaining, MSG_NOSIGNAL);
+      if (n <= 0) {
+        break;
+      }
+      p += n;
+      remaining -= n;
+    }
+    close(fd);
+  }
+};
+
+} // namespace monitor
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "checkpoint_registry.hpp"
+#include "config.hpp"
+#include "sched_state.hpp"
+#include "shared_segment.hpp"
+#include "types.hpp"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace monitor {
+
+// the last events of each monitored thread in a memory mapped file, the
+// page cache keeps them when the process dies (even by SIGKILL), i.e. they
+// can be read post-mortem (see flight_dump_main.cpp)
+
+enum class flight_event_type : uint8_t { expect, confirm };
+
+struct flight_event {
+  // start of the checkpoint (expect) or confirmation time
+  time_t time;
+  checkpoint_id_t id;
+  checkpoint_index_t index;
+  // nesting depth of the checkpoint (1 is the outermost)
+  uint16_t depth;
+  flight_event_type type;
+};
+
+// events of one thread, only written by the thread itself,
+// recording costs a few stores and no syscall
+class alignas(64) flight_ring {
+public:
+  bool claim(os_tid_t os_tid) {
+    uint32_t expected = 0;
+    if (!m_used.compare_exchange_strong(expected, 1,
+                                        std::memory_order_acq_rel)) {
+      return false;
+    }
+    m_os_tid.store(os_tid, std::memory_order_relaxed);
+    m_head.store(0, std::memory_order_release);
+    return true;
+  }
+
+  // the events are kept until the ring is claimed again
+  void release() { m_used.store(0, std::memory_order_release); }
+
+  os_tid_t os_tid() const { return m_os_tid.load(std::memory_order_relaxed); }
+
+  // number of events recorded so far
+  uint64_t head() const { return m_head.load(std::memory_order_acquire); }
+
+  void record(flight_event_type type, time_t time, checkpoint_id_t id,
+              checkpoint_index_t index, uint32_t depth) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    auto &e = events_ptr()[head % m_capacity];
+    e.time = time;
+    e.id = id;
+    e.index = index;
+    e.depth = static_cast<uint16_t>(depth);
+    e.type = type;
+    // an event only counts when it is complete
+    m_head.store(head + 1, std::memory_order_release);
+  }
+
+  // complete events from old to new, the slot written next may be torn
+  // (if the writer died) and is skipped
+  std::vector<flight_event> events() const {
+    std::vector<flight_event> result;
+    if (m_capacity == 0) {
+      return result; // not initialized (or corrupted)
+    }
+    auto head = this->head();
+    uint64_t first = head >= m_capacity ? head - m_capacity + 1 : 0;
+    result.reserve(head - first);
+    for (auto i = first; i < head; ++i) {
+      result.push_back(events_ptr()[i % m_capacity]);
+    }
+    return result;
+  }
+
+  // the slot written next is never reported
+  static constexpr uint32_t MIN_CAPACITY = 2;
+
+  static size_t size(uint32_t capacity) {
+    return (sizeof(flight_ring) + capacity * sizeof(flight_event) + 63) / 64 *
+           64;
+  }
+
+  void init(uint32_t capacity) { m_capacity = capacity; }
+
+  uint32_t capacity() const { return m_capacity; }
+
+private:
+  std::atomic<uint32_t> m_used{0};
+  std::atomic<os_tid_t> m_os_tid{0};
+  uint32_t m_capacity{0};
+  std::atomic<uint64_t> m_head{0};
+
+  // capacity events follow the ring in the file
+  flight_event *events_ptr() {
+    return reinterpret_cast<flight_event *>(this + 1);
+  }
+
+  const flight_event *events_ptr() const {
+    return reinterpret_cast<const flight_event *>(this + 1);
+  }
+};
+
+struct flight_recorder_header {
+  static constexpr uint64_t MAGIC = 0x666c696768747201; // "flightr" v1
+
+  std::atomic<uint64_t> magic{0};
+  int32_t pid{0};
+  char process[16]{};
+  uint32_t max_threads{0};
+  uint32_t events{0};
+  uint32_t site_count{0};
+  uint64_t ring_size{0};
+  uint64_t threads_offset{0};
+  uint64_t sites_offset{0};
+  uint64_t size{0};
+};
+
+// the file, created by the monitored process, opened read-only by the
+// dump tool
+class flight_recorder {
+public:
+  static std::unique_ptr<flight_recorder>
+  create(const std::string &path, uint32_t events = FLIGHT_RECORDER_EVENTS,
+         uint32_t max_threads = MAX_THREADS);
+
+  static std::unique_ptr<flight_recorder> open(const std::string &path);
+
+  ~flight_recorder() { munmap(m_base, m_size); }
+
+  flight_recorder(const flight_recorder &) = delete;
+  flight_recorder &operator=(const flight_recorder &) = delete;
+
+  const flight_recorder_header &header() const {
+    return *reinterpret_cast<const flight_recorder_header *>(m_base);
+  }
+
+  uint32_t max_threads() const { return header().max_threads; }
+
+  flight_ring &ring(uint32_t i) {
+    return *reinterpret_cast<flight_ring *>(
+        m_base + header().threads_offset + i * header().ring_size);
+  }
+
+  // nullptr for unregistered checkpoints
+  const shared_site *site(checkpoint_index_t index) {
+    if (index >= header().site_count) {
+      return nullptr;
+    }
+    return reinterpret_cast<const shared_site *>(m_base +
+                                                 header().sites_offset) +
+           index;
+  }
+
+  // ring for the calling thread, nullptr if all are in use
+  flight_ring *claim(os_tid_t os_tid) {
+    for (uint32_t i = 0; i < max_threads(); ++i) {
+      if (ring(i).claim(os_tid)) {
+        return &ring(i);
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  char *m_base;
+  size_t m_size;
+
+  flight_recorder(void *base, size_t size)
+      : m_base(static_cast<char *>(base)), m_size(size) {}
+};
+
+// checkpoints that were still active at the last event (the sections in
+// progress when the thread stopped), from the outermost to the innermost
+inline std::vector<flight_event>
+in_progress(const std::vector<flight_event> &events) {
+  std::vector<flight_event> active;
+  for (auto &e : events) {
+    // by depth, the oldest events may be lost
+    while (!active.empty() && active.back().depth >= e.depth) {
+      active.pop_back();
+    }
+    if (e.type == flight_event_type::expect) {
+      active.push_back(e);
+    }
+  }
+  return active;
+}
+
+inline std::unique_ptr<flight_recorder>
+flight_recorder::create(const std::string &path, uint32_t events,
+                        uint32_t max_threads) {
+  if (events < flight_ring::MIN_CAPACITY) {
+    return nullptr;
+  }
+  auto sites = checkpoint_registry::count();
+  uint64_t ring_size = flight_ring::size(events);
+  uint64_t threads_offset = (sizeof(flight_recorder_header) + 63) / 64 * 64;
+  uint64_t sites_offset = threads_offset + max_threads * ring_size;
+  uint64_t size = sites_offset + uint64_t(sites) * sizeof(shared_site);
+
+  int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::unique_ptr<flight_recorder> recorder(new flight_recorder(p, size));
+  auto header = new (p) flight_recorder_header();
+  header->pid = getpid();
+  std::ifstream comm("/proc/self/comm");
+  comm.getline(header->process, sizeof(header->process));
+  header->max_threads = max_threads;
+  header->events = events;
+  header->site_count = sites;
+  header->ring_size = ring_size;
+  header->threads_offset = threads_offset;
+  header->sites_offset = sites_offset;
+  header->size = size;
+
+  for (uint32_t i = 0; i < max_threads; ++i) {
+    new (&recorder->ring(i)) flight_ring();
+    recorder->ring(i).init(events);
+  }
+  auto table =
+      reinterpret_cast<shared_site *>(recorder->m_base + sites_offset);
+  for (checkpoint_index_t i = 0; i < sites; ++i) {
+    auto &location = checkpoint_registry::location(i);
+    auto s = new (&table[i]) shared_site();
+    s->line = location.line;
+    if (location.file) {
+      std::strncpy(s->file, location.file, WATCHDOG_SITE_CHARS - 1);
+    }
+    if (location.function) {
+      std::strncpy(s->function, location.function, WATCHDOG_SITE_CHARS - 1);
+    }
+  }
+
+  header->magic.store(flight_recorder_header::MAGIC, std::memory_order_release);
+  return recorder;
+}
+
+inline std::unique_ptr<flight_recorder>
+flight_recorder::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      size_t(st.st_size) < sizeof(flight_recorder_header)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = st.st_size;
+  void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::unique_ptr<flight_recorder> recorder(new flight_recorder(p, size));
+  auto &header = recorder->header();
+  if (header.magic.load(std::memory_order_acquire) !=
+          flight_recorder_header::MAGIC ||
+      header.size > size || header.events < flight_ring::MIN_CAPACITY ||
+      header.ring_size != flight_ring::size(header.events)) {
+    return nullptr;
+  }
+
+  // the file may be truncated or corrupted (it outlives its writer),
+  // the rings and the sites must be within it
+  if (header.threads_offset < sizeof(flight_recorder_header) ||
+      header.threads_offset > header.size ||
+      header.max_threads >
+          (header.size - header.threads_offset) / header.ring_size) {
+    return nullptr;
+  }
+  auto rings_end =
+      header.threads_offset + header.max_threads * header.ring_size;
+  if (header.sites_offset < rings_end || header.sites_offset > header.size ||
+      header.site_count >
+          (header.size - header.sites_offset) / sizeof(shared_site)) {
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < header.max_threads; ++i) {
+    if (recorder->ring(i).capacity() != header.events) {
+      return nullptr;
+    }
+  }
+  return recorder;
+}
+
+} // namespace monitor
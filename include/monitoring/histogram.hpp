@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace monitor {
+
+// fixed memory log-linear (HDR style) histogram of unsigned integer values
+// each power of 2 range is divided into 2^SubBucketBits linear sub-buckets,
+// hence the relative error of any reported value is at most 2^-SubBucketBits
+// values of MaxValueBits or more bits are counted in the highest bucket
+//
+// recording is integer only (a bit scan, a shift and an increment),
+// histograms of the same type can be merged by adding the buckets
+template <uint32_t SubBucketBits, uint32_t MaxValueBits>
+class log_linear_histogram {
+  static_assert(SubBucketBits > 0 && SubBucketBits < MaxValueBits,
+                "invalid sub-bucket configuration");
+  static_assert(MaxValueBits <= 64, "values are at most 64 bit");
+
+public:
+  using value_t = uint64_t;
+  using count_t = uint64_t;
+
+  static constexpr uint32_t SUB_BUCKETS = 1U << SubBucketBits;
+  static constexpr uint32_t NUM_BUCKETS = (MaxValueBits - SubBucketBits + 1)
+                                          << SubBucketBits;
+  static constexpr value_t MAX_VALUE =
+      MaxValueBits == 64 ? std::numeric_limits<value_t>::max()
+                         : (value_t(1) << (MaxValueBits % 64)) - 1;
+
+  void record(value_t value) { ++m_buckets[index(value)]; }
+
+  void merge(const log_linear_histogram &other) {
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+      m_buckets[i] += other.m_buckets[i];
+    }
+  }
+
+  void clear() { m_buckets.fill(0); }
+
+  count_t count() const {
+    count_t n = 0;
+    for (auto c : m_buckets) {
+      n += c;
+    }
+    return n;
+  }
+
+  // smallest value v (up to the bucket resolution) such that at least
+  // a fraction q of all recorded values is <= v, 0 if there are no values
+  value_t value_at_quantile(double q) const {
+    auto n = count();
+    if (n == 0) {
+      return 0;
+    }
+
+    q = std::min(std::max(q, 0.0), 1.0);
+    auto target = static_cast<count_t>(std::ceil(q * double(n)));
+    if (target == 0) {
+      target = 1;
+    }
+
+    count_t cumulative = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+      cumulative += m_buckets[i];
+      if (cumulative >= target) {
+        return upper_bound(i);
+      }
+    }
+    return MAX_VALUE;
+  }
+
+  // estimate based on the bucket midpoints
+  double mean() const {
+    double sum = 0;
+    count_t n = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+      auto c = m_buckets[i];
+      if (c > 0) {
+        sum += c * midpoint(i);
+        n += c;
+      }
+    }
+    return n > 0 ? sum / n : 0;
+  }
+
+  // estimate based on the bucket midpoints
+  double variance() const {
+    auto n = count();
+    if (n < 2) {
+      return 0;
+    }
+    auto m = mean();
+    double sum = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+      auto c = m_buckets[i];
+      if (c > 0) {
+        auto d = midpoint(i) - m;
+        sum += c * d * d;
+      }
+    }
+    return sum / (n - 1);
+  }
+
+  count_t bucket(uint32_t index) const { return m_buckets[index]; }
+
+  static uint32_t index(value_t value) {
+    if (value > MAX_VALUE) {
+      value = MAX_VALUE;
+    }
+    if (value < SUB_BUCKETS) {
+      return static_cast<uint32_t>(value);
+    }
+    uint32_t msb = 63 - __builtin_clzll(value);
+    uint32_t shift = msb - SubBucketBits;
+    // the shifted value is in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+    return (shift << SubBucketBits) + static_cast<uint32_t>(value >> shift);
+  }
+
+  static value_t lower_bound(uint32_t index) {
+    if (index < 2 * SUB_BUCKETS) {
+      return index;
+    }
+    uint32_t shift = (index >> SubBucketBits) - 1;
+    value_t sub = index - (shift << SubBucketBits);
+    return sub << shift;
+  }
+
+  static value_t upper_bound(uint32_t index) {
+    if (index < 2 * SUB_BUCKETS) {
+      return index;
+    }
+    uint32_t shift = (index >> SubBucketBits) - 1;
+    value_t sub = index - (shift << SubBucketBits);
+    return ((sub + 1) << shift) - 1;
+  }
+
+private:
+  std::array<count_t, NUM_BUCKETS> m_buckets{};
+
+  static double midpoint(uint32_t index) {
+    return (double(lower_bound(index)) + double(upper_bound(index))) / 2;
+  }
+};
+
+} // namespace monitor
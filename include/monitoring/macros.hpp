@@ -4,6 +4,9 @@
 
 #include "api.hpp"
 
+#define MONITORING_CONCAT_IMPL(a, b) a##b
+#define MONITORING_CONCAT(a, b) MONITORING_CONCAT_IMPL(a, b)
+
 #ifdef MONITORING_OFF
 
 #define START_THIS_THREAD_MONITORING
@@ -24,6 +27,16 @@
 
 #define STOP_ACTIVE_MONITORING
 
+#define MONITORED_WAIT(signal, waitable, budget)                               \
+  do {                                                                         \
+    signal = (waitable).wait();                                                \
+  } while (0)
+
+#define MONITORED_WAIT_FOR(signal, waitable, timeout)                          \
+  do {                                                                         \
+    signal = (waitable).wait_for(timeout);                                     \
+  } while (0)
+
 #else
 
 #ifdef MONITORING_MODE_ACTIVE
@@ -59,7 +72,10 @@
 
 #define EXPECT_PROGRESS_IN(timeout, checkpoint_id)                             \
   do {                                                                         \
-    monitor::expect_progress_in(timeout, checkpoint_id, THIS_SOURCE_LOCATION); \
+    DEFINE_CHECKPOINT_SITE(monitoring_site_);                                  \
+    monitor::expect_progress_in(timeout, checkpoint_id,                        \
+                                monitoring_site_::index(),                     \
+                                THIS_SOURCE_LOCATION);                         \
   } while (0)
 
 #define CONFIRM_PROGRESS                                                       \
@@ -67,8 +83,31 @@
     monitor::confirm_progress(THIS_SOURCE_LOCATION);                           \
   } while (0)
 
+// declares variables in the current scope, at most once per line
 #define EXPECT_SCOPE_END_REACHED_IN(deadline, checkpoint_id)                   \
-  monitor::guard(deadline, checkpoint_id, THIS_SOURCE_LOCATION)
+  DEFINE_CHECKPOINT_SITE(MONITORING_CONCAT(monitoring_site_, __LINE__));       \
+  monitor::guard MONITORING_CONCAT(monitoring_guard_, __LINE__)(               \
+      deadline, checkpoint_id,                                                 \
+      MONITORING_CONCAT(monitoring_site_, __LINE__)::index(),                  \
+      THIS_SOURCE_LOCATION)
+
+// assigns the signal (WaitState::WAITING on timeout) of a wait on a
+// SingleWait, the wait is monitored with the budget (or the timeout)
+#define MONITORED_WAIT(signal, waitable, budget)                               \
+  do {                                                                         \
+    DEFINE_WAIT_SITE(monitoring_site_);                                        \
+    signal = monitor::monitored_wait(waitable, budget,                         \
+                                     monitoring_site_::index(),                \
+                                     THIS_SOURCE_LOCATION);                    \
+  } while (0)
+
+#define MONITORED_WAIT_FOR(signal, waitable, timeout)                          \
+  do {                                                                         \
+    DEFINE_WAIT_SITE(monitoring_site_);                                        \
+    signal = monitor::monitored_wait_for(waitable, timeout,                    \
+                                         monitoring_site_::index(),            \
+                                         THIS_SOURCE_LOCATION);                \
+  } while (0)
 
 #endif
 
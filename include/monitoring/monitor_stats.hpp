@@ -0,0 +1,78 @@
+#pragma once
+
+#include "statistics.hpp"
+#include "time.hpp"
+
+#include <stdint.h>
+
+#include <iostream>
+
+namespace monitor {
+
+// thread and entry counts per tick
+using count_histogram = log_linear_histogram<4, 32>;
+
+// what the active monitoring thread observed in one tick (one scan)
+struct monitor_tick {
+  time_t scan_duration{0};
+  uint32_t registered_threads{0};
+  uint64_t entries_walked{0};
+  // threads whose stack changed during the scan (checked in the next tick)
+  uint64_t aborted_scans{0};
+};
+
+// statistics of the active monitoring thread itself,
+// e.g. to choose the monitoring interval and bound the detection latency
+struct monitor_stats {
+  uint64_t ticks{0};
+  uint64_t aborted_scans{0};
+  uint64_t detections{0};
+
+  // in time units
+  latency_histogram scan_duration;
+  count_histogram registered_threads;
+  count_histogram entries_walked;
+  count_histogram aborted_per_tick;
+  // time between a deadline and its detection by the monitoring thread
+  latency_histogram detection_lag;
+
+  void record(const monitor_tick &tick) {
+    ++ticks;
+    aborted_scans += tick.aborted_scans;
+    scan_duration.record(tick.scan_duration);
+    registered_threads.record(tick.registered_threads);
+    entries_walked.record(tick.entries_walked);
+    aborted_per_tick.record(tick.aborted_scans);
+  }
+
+  void record_detection(time_t lag) {
+    ++detections;
+    detection_lag.record(lag);
+  }
+
+  void clear() { *this = monitor_stats(); }
+
+  void print() const {
+    std::cout << "monitor ticks : " << ticks << std::endl;
+    print("scan duration", scan_duration);
+    print("registered threads", registered_threads);
+    print("entries walked", entries_walked);
+    std::cout << "aborted scans : " << aborted_scans << std::endl;
+    std::cout << "detections : " << detections << std::endl;
+    print("detection lag", detection_lag);
+  }
+
+private:
+  template <typename Histogram>
+  static void print(const char *name, const Histogram &h) {
+    if (h.count() == 0) {
+      return;
+    }
+    std::cout << name << " : mean " << h.mean() << " p50 "
+              << h.value_at_quantile(0.5) << " p99 "
+              << h.value_at_quantile(0.99) << " max "
+              << h.value_at_quantile(1) << std::endl;
+  }
+};
+
+} // namespace monitor
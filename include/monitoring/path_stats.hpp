@@ -0,0 +1,197 @@
+#pragma once
+
+#include "checkpoint_registry.hpp"
+#include "config.hpp"
+#include "time.hpp"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace monitor {
+
+// node in the tree of nested checkpoints, the root is no checkpoint
+constexpr path_index_t ROOT_PATH = 0;
+// collects the checkpoints (and everything nested in them) that did not fit
+// into the tree of a thread
+constexpr path_index_t OVERFLOW_PATH = 1;
+
+// time of a checkpoint path, inclusive time contains the nested checkpoints,
+// self time does not
+struct path_time {
+  uint64_t count{0};
+  uint64_t inclusive{0};
+  uint64_t self{0};
+
+  void merge(const path_time &other) {
+    count += other.count;
+    inclusive += other.inclusive;
+    self += other.self;
+  }
+};
+
+// checkpoint sites from the outermost to the innermost checkpoint,
+// the empty path collects what did not fit into the per thread trees
+using checkpoint_path = std::vector<checkpoint_index_t>;
+using path_profile = std::map<checkpoint_path, path_time>;
+
+// the checkpoint tree of a single thread, paths are interned once (i.e. the
+// tree only grows) and identified by their node index afterwards,
+// like local_stats there is one writer which never waits and readers take
+// seqlock style snapshots of the nodes
+class local_paths {
+public:
+  explicit local_paths(uint32_t capacity = STATS_MAX_PATHS)
+      : m_capacity(std::max(capacity, 2U)),
+        m_nodes(std::make_unique<node[]>(m_capacity)) {}
+
+  local_paths(const local_paths &) = delete;
+
+  // writer only, usually a short walk over the known children,
+  // if the tree is full the overflow node collects the time (also of the
+  // checkpoints nested in it)
+  path_index_t child(path_index_t parent, checkpoint_index_t site) {
+    if (parent == OVERFLOW_PATH) {
+      return OVERFLOW_PATH;
+    }
+    auto &p = m_nodes[parent];
+    auto i = p.first_child;
+    while (i != ROOT_PATH) {
+      auto &n = m_nodes[i];
+      if (n.site == site) {
+        return i;
+      }
+      i = n.next_sibling;
+    }
+
+    auto size = m_size.load(std::memory_order_relaxed);
+    if (size >= m_capacity) {
+      return OVERFLOW_PATH;
+    }
+    auto &n = m_nodes[size];
+    n.parent = parent;
+    n.site = site;
+    n.next_sibling = p.first_child;
+    p.first_child = size;
+    // parent and site are immutable from now on
+    m_size.store(size + 1, std::memory_order_release);
+    return size;
+  }
+
+  // writer only
+  void update(path_index_t path, time_t inclusive, time_t self) {
+    auto &n = m_nodes[path];
+    auto seq = n.seq.load(std::memory_order_relaxed);
+    n.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ++n.time.count;
+    n.time.inclusive += inclusive;
+    n.time.self += self;
+
+    n.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  // never blocks the writer (but may have to retry)
+  void merge_into(path_profile &result) {
+    auto size = m_size.load(std::memory_order_acquire);
+    std::vector<checkpoint_path> paths(size);
+    for (uint32_t i = 0; i < size; ++i) {
+      auto &n = m_nodes[i];
+      // the root and the overflow node are the empty path
+      if (i != ROOT_PATH && i != OVERFLOW_PATH) {
+        // parents are always created before their children
+        paths[i] = paths[n.parent];
+        paths[i].push_back(n.site);
+      }
+
+      path_time snapshot;
+      while (!try_load(n, snapshot))
+        ;
+      if (snapshot.count > 0) {
+        result[paths[i]].merge(snapshot);
+      }
+    }
+  }
+
+  uint32_t size() { return m_size.load(std::memory_order_relaxed); }
+
+  // only allowed if there are no concurrent readers and writers
+  void clear() {
+    for (uint32_t i = 0; i < m_capacity; ++i) {
+      auto &n = m_nodes[i];
+      n.first_child = ROOT_PATH;
+      n.next_sibling = ROOT_PATH;
+      n.time = path_time();
+    }
+    m_size.store(2, std::memory_order_relaxed);
+  }
+
+private:
+  struct node {
+    path_index_t parent{ROOT_PATH};
+    checkpoint_index_t site{UNREGISTERED_CHECKPOINT};
+    // only used by the writer, ROOT_PATH means none
+    path_index_t first_child{ROOT_PATH};
+    path_index_t next_sibling{ROOT_PATH};
+
+    std::atomic<uint64_t> seq{0};
+    path_time time;
+  };
+
+  uint32_t m_capacity;
+  std::unique_ptr<node[]> m_nodes;
+  // the root and the overflow node always exist
+  std::atomic<uint32_t> m_size{2};
+
+  bool try_load(node &n, path_time &result) {
+    auto seq = n.seq.load(std::memory_order_acquire);
+    if (seq % 2 != 0) {
+      return false; // concurrent modification
+    }
+
+    result = n.time;
+
+    // ensure the copy happens before we check the sequence again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq == n.seq.load(std::memory_order_relaxed);
+  }
+};
+
+inline void write_frame(std::ostream &out, checkpoint_index_t site) {
+  if (site >= checkpoint_registry::count()) {
+    out << "unregistered";
+    return;
+  }
+  auto &location = checkpoint_registry::location(site);
+  out << location.function << " (" << location.file << ":" << location.line
+      << ")";
+}
+
+// folded stacks (one path per line, weighted with the self time in time
+// units), the input format of the usual flame graph tools
+inline void write_folded(std::ostream &out, const path_profile &profile) {
+  for (auto &p : profile) {
+    auto &path = p.first;
+    if (p.second.self == 0) {
+      continue;
+    }
+    if (path.empty()) {
+      out << "[other]";
+    }
+    for (size_t i = 0; i < path.size(); ++i) {
+      if (i > 0) {
+        out << ";";
+      }
+      write_frame(out, path[i]);
+    }
+    out << " " << p.second.self << "\n";
+  }
+}
+
+} // namespace monitor
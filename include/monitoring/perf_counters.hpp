@@ -0,0 +1,199 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace monitor {
+
+// hardware (or software) counters of the calling thread, user space only,
+// e.g. per benchmark iteration or per checkpoint (MONITORING_STATS_PERF)
+// counters that are not available or not permitted (see
+// /proc/sys/kernel/perf_event_paranoid) are skipped and read as 0
+
+struct perf_event_spec {
+  uint32_t type;
+  uint64_t config;
+  const char *name;
+};
+
+constexpr uint32_t PERF_MAX_EVENTS = 5;
+
+constexpr uint64_t perf_cache_event(uint64_t cache, uint64_t op,
+                                    uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+// instructions, cycles, L1 data cache misses, last level cache misses and
+// branch misses
+inline const std::vector<perf_event_spec> &default_perf_events() {
+  static const std::vector<perf_event_spec> events{
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+      {PERF_TYPE_HW_CACHE,
+       perf_cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                        PERF_COUNT_HW_CACHE_RESULT_MISS),
+       "l1d_misses"},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "llc_misses"},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses"}};
+  return events;
+}
+
+// values in the order of the events
+struct perf_sample {
+  uint64_t values[PERF_MAX_EVENTS]{};
+};
+
+// counts between two samples of the same counters
+inline perf_sample operator-(const perf_sample &end, const perf_sample &start) {
+  perf_sample result;
+  for (uint32_t i = 0; i < PERF_MAX_EVENTS; ++i) {
+    result.values[i] = end.values[i] - start.values[i];
+  }
+  return result;
+}
+
+// the counters are opened as one group, i.e. they count the same code and
+// a read is a single system call (about a microsecond)
+class perf_counters {
+public:
+  // at most PERF_MAX_EVENTS events
+  explicit perf_counters(
+      const std::vector<perf_event_spec> &events = default_perf_events())
+      : m_events(events.begin(),
+                 events.begin() + std::min<size_t>(events.size(),
+                                                   PERF_MAX_EVENTS)) {
+    std::fill(std::begin(m_fds), std::end(m_fds), -1);
+    for (uint32_t i = 0; i < m_events.size(); ++i) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = m_events[i].type;
+      attr.config = m_events[i].config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      // the members follow the leader
+      attr.disabled = m_leader < 0 ? 1 : 0;
+
+      auto fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0));
+      m_fds[i] = fd;
+      if (fd < 0) {
+        continue;
+      }
+      if (m_leader < 0) {
+        m_leader = fd;
+      }
+      // position in the group read
+      m_positions[i] = m_opened++;
+    }
+  }
+
+  ~perf_counters() {
+    // the leader last
+    for (auto i = m_events.size(); i > 0; --i) {
+      if (m_fds[i - 1] >= 0) {
+        close(m_fds[i - 1]);
+      }
+    }
+  }
+
+  perf_counters(const perf_counters &) = delete;
+  perf_counters &operator=(const perf_counters &) = delete;
+
+  // whether any counter is available
+  bool valid() const { return m_leader >= 0; }
+
+  size_t size() const { return m_events.size(); }
+
+  const perf_event_spec &event(size_t i) const { return m_events[i]; }
+
+  bool available(size_t i) const { return m_fds[i] >= 0; }
+
+  // resets the counts
+  void start() {
+    if (valid()) {
+      ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+
+  void stop() {
+    if (valid()) {
+      ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+
+  // since the last start
+  perf_sample read() const {
+    perf_sample result;
+    if (!valid()) {
+      return result;
+    }
+    // number of counters followed by their values
+    uint64_t buffer[PERF_MAX_EVENTS + 1];
+    auto size = (m_opened + 1) * sizeof(uint64_t);
+    if (::read(m_leader, buffer, size) != ssize_t(size)) {
+      return result;
+    }
+    for (uint32_t i = 0; i < m_events.size(); ++i) {
+      if (m_fds[i] >= 0) {
+        result.values[i] = buffer[1 + m_positions[i]];
+      }
+    }
+    return result;
+  }
+
+private:
+  std::vector<perf_event_spec> m_events;
+  int m_fds[PERF_MAX_EVENTS];
+  uint32_t m_positions[PERF_MAX_EVENTS]{};
+  uint32_t m_opened{0};
+  int m_leader{-1};
+};
+
+// counters per checkpoint in stats mode (MONITORING_STATS_PERF)
+inline const std::vector<perf_event_spec> &stats_perf_events() {
+  static const std::vector<perf_event_spec> events{
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache_misses"}};
+  return events;
+}
+
+// what the runs of a checkpoint executed (stats_perf_events)
+struct perf_attribution {
+  uint64_t count{0};
+  uint64_t instructions{0};
+  uint64_t cache_misses{0};
+
+  void update(const perf_sample &used) {
+    ++count;
+    instructions += used.values[0];
+    cache_misses += used.values[1];
+  }
+
+  void merge(const perf_attribution &other) {
+    count += other.count;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+  }
+
+  // means per run
+  void print() const {
+    if (count == 0) {
+      return;
+    }
+    std::cout << "instructions : " << double(instructions) / count
+              << " cache misses : " << double(cache_misses) / count
+              << std::endl;
+  }
+};
+
+} // namespace monitor
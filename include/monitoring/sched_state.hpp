@@ -0,0 +1,174 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace monitor {
+
+// linux thread id (std::thread::id cannot be mapped to /proc)
+using os_tid_t = pid_t;
+
+inline os_tid_t this_os_tid() {
+  return static_cast<os_tid_t>(syscall(SYS_gettid));
+}
+
+enum class sched_class {
+  unknown,
+  // on a CPU
+  running,
+  // ready but waiting for a CPU (CPU starvation)
+  runnable,
+  // interruptible sleep, e.g. a futex (lock wait) or a blocking read
+  sleeping,
+  // uninterruptible sleep, e.g. disk I/O or a page fault
+  blocked,
+  // stopped or traced
+  stopped,
+  // terminated
+  dead
+};
+
+inline const char *to_string(sched_class c) {
+  switch (c) {
+  case sched_class::running:
+    return "running";
+  case sched_class::runnable:
+    return "runnable";
+  case sched_class::sleeping:
+    return "sleeping";
+  case sched_class::blocked:
+    return "blocked";
+  case sched_class::stopped:
+    return "stopped";
+  case sched_class::dead:
+    return "dead";
+  default:
+    return "unknown";
+  }
+}
+
+// kernel view of a (late) thread, read from /proc/self/task/<tid>
+struct sched_state {
+  sched_class classification{sched_class::unknown};
+  // state letter of /proc/.../stat, 0 if unknown
+  char state{0};
+  // from schedstat, in ns
+  uint64_t run_time{0};
+  uint64_t wait_time{0};
+  uint64_t timeslices{0};
+  // kernel function the thread sleeps in (if permitted, "0" otherwise)
+  std::string wchan;
+};
+
+inline std::ostream &operator<<(std::ostream &out, const sched_state &s) {
+  out << to_string(s.classification);
+  if (s.state) {
+    out << " (" << s.state << ")";
+  }
+  out << " run " << s.run_time << " ns wait " << s.wait_time << " ns";
+  if (!s.wchan.empty() && s.wchan != "0") {
+    out << " in " << s.wchan;
+  }
+  return out;
+}
+
+namespace detail {
+
+inline std::string task_path(os_tid_t tid, const char *file) {
+  return "/proc/self/task/" + std::to_string(tid) + "/" + file;
+}
+
+// the state follows the command name in parentheses (which may contain
+// anything, hence the last parenthesis)
+inline char read_task_state(os_tid_t tid) {
+  std::ifstream in(task_path(tid, "stat"));
+  std::string line;
+  if (!std::getline(in, line)) {
+    return 0;
+  }
+  auto pos = line.rfind(')');
+  if (pos == std::string::npos || pos + 2 >= line.size()) {
+    return 0;
+  }
+  return line[pos + 2];
+}
+
+inline bool read_schedstat(os_tid_t tid, sched_state &s) {
+  std::ifstream in(task_path(tid, "schedstat"));
+  return bool(in >> s.run_time >> s.wait_time >> s.timeslices);
+}
+
+inline std::string read_wchan(os_tid_t tid) {
+  std::ifstream in(task_path(tid, "wchan"));
+  std::string result;
+  std::getline(in, result);
+  return result;
+}
+
+inline sched_class classify(char state) {
+  switch (state) {
+  case 'R':
+    return sched_class::running;
+  case 'S':
+    return sched_class::sleeping;
+  case 'D':
+    return sched_class::blocked;
+  case 'T':
+  case 't':
+    return sched_class::stopped;
+  case 'Z':
+  case 'X':
+  case 'x':
+    return sched_class::dead;
+  default:
+    return sched_class::unknown;
+  }
+}
+
+} // namespace detail
+
+// the state letter R does not distinguish running and runnable threads,
+// in this case schedstat is sampled twice and the thread counts as runnable
+// if it waited for a CPU rather than ran in between
+inline sched_state read_sched_state(os_tid_t tid) {
+  using namespace detail;
+  sched_state result;
+  if (tid <= 0) {
+    return result;
+  }
+
+  result.state = read_task_state(tid);
+  result.classification = classify(result.state);
+  bool stats = read_schedstat(tid, result);
+  result.wchan = read_wchan(tid);
+
+  if (result.classification == sched_class::running && stats) {
+    sched_state later;
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(SCHED_STATE_SAMPLE_US));
+    if (read_schedstat(tid, later)) {
+      auto ran = later.run_time - result.run_time;
+      auto waited = later.wait_time - result.wait_time;
+      if (waited > ran) {
+        result.classification = sched_class::runnable;
+      }
+      result.run_time = later.run_time;
+      result.wait_time = later.wait_time;
+      result.timeslices = later.timeslices;
+    }
+  }
+  return result;
+}
+
+} // namespace monitor
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "checkpoint_registry.hpp"
+#include "config.hpp"
+#include "sched_state.hpp"
+#include "types.hpp"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace monitor {
+
+// mirror of the deadline stacks of a process in a named shared memory
+// segment, read by an out-of-process watchdog (see watchdog.hpp)
+// the segment contains no pointers, the thread slots and the site table are
+// addressed by offsets from the start of the segment
+
+// checkpoint site, copied from the registry when the segment is created
+struct shared_site {
+  uint32_t line{0};
+  char file[WATCHDOG_SITE_CHARS]{};
+  char function[WATCHDOG_SITE_CHARS]{};
+};
+
+// one monitored thread, only written by the thread itself (seqlock),
+// the outermost WATCHDOG_MAX_DEPTH levels are mirrored, deeper nesting is
+// only reflected in the depth and the minimum deadline
+class alignas(64) shared_thread_slot {
+public:
+  struct entry {
+    time_t deadline;
+    checkpoint_id_t id;
+    checkpoint_index_t index;
+  };
+
+  // what the watchdog reads
+  struct snapshot {
+    os_tid_t os_tid;
+    uint32_t depth;
+    time_t min_deadline;
+    entry entries[WATCHDOG_MAX_DEPTH];
+
+    uint32_t mirrored() const { return std::min(depth, WATCHDOG_MAX_DEPTH); }
+  };
+
+  bool claim(os_tid_t os_tid) {
+    uint32_t expected = 0;
+    if (!m_used.compare_exchange_strong(expected, 1,
+                                        std::memory_order_acq_rel)) {
+      return false;
+    }
+    m_os_tid.store(os_tid, std::memory_order_relaxed);
+    pop(0, 0);
+    return true;
+  }
+
+  void release() {
+    pop(0, 0);
+    m_os_tid.store(0, std::memory_order_relaxed);
+    m_used.store(0, std::memory_order_release);
+  }
+
+  bool used() const { return m_used.load(std::memory_order_acquire) != 0; }
+
+  // writer only, depth after the push
+  void push(uint32_t depth, time_t deadline, time_t min_deadline,
+            checkpoint_id_t id, checkpoint_index_t index) {
+    begin_write();
+    if (depth <= WATCHDOG_MAX_DEPTH) {
+      auto &e = m_entries[depth - 1];
+      e.deadline.store(deadline, std::memory_order_relaxed);
+      e.id.store(id, std::memory_order_relaxed);
+      e.index.store(index, std::memory_order_relaxed);
+    }
+    m_depth.store(depth, std::memory_order_relaxed);
+    m_min_deadline.store(min_deadline, std::memory_order_relaxed);
+    end_write();
+  }
+
+  // writer only, depth and minimum deadline after the pop
+  void pop(uint32_t depth, time_t min_deadline) {
+    begin_write();
+    m_depth.store(depth, std::memory_order_relaxed);
+    m_min_deadline.store(min_deadline, std::memory_order_relaxed);
+    end_write();
+  }
+
+  // fails if the thread pushes or pops concurrently
+  bool try_load(snapshot &result) const {
+    auto seq = m_seq.load(std::memory_order_acquire);
+    if (seq % 2 != 0) {
+      return false;
+    }
+
+    result.os_tid = m_os_tid.load(std::memory_order_relaxed);
+    result.depth = m_depth.load(std::memory_order_relaxed);
+    result.min_deadline = m_min_deadline.load(std::memory_order_relaxed);
+    auto n = result.mirrored();
+    for (uint32_t i = 0; i < n; ++i) {
+      auto &e = m_entries[i];
+      result.entries[i] = {e.deadline.load(std::memory_order_relaxed),
+                           e.id.load(std::memory_order_relaxed),
+                           e.index.load(std::memory_order_relaxed)};
+    }
+
+    // ensure the loads happen before we check the sequence again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq == m_seq.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct atomic_entry {
+    std::atomic<time_t> deadline{0};
+    std::atomic<checkpoint_id_t> id{0};
+    std::atomic<checkpoint_index_t> index{0};
+  };
+
+  std::atomic<uint64_t> m_seq{0};
+  std::atomic<uint32_t> m_used{0};
+  std::atomic<os_tid_t> m_os_tid{0};
+  std::atomic<uint32_t> m_depth{0};
+  std::atomic<time_t> m_min_deadline{0};
+  atomic_entry m_entries[WATCHDOG_MAX_DEPTH];
+
+  void begin_write() {
+    auto seq = m_seq.load(std::memory_order_relaxed);
+    m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void end_write() {
+    m_seq.fetch_add(1, std::memory_order_release);
+  }
+};
+
+struct shared_segment_header {
+  static constexpr uint64_t MAGIC = 0x6d6f6e69746f7201; // "monitor" v1
+
+  std::atomic<uint64_t> magic{0};
+  int32_t pid{0};
+  char process[16]{};
+  uint32_t max_threads{0};
+  uint32_t max_depth{0};
+  uint32_t site_count{0};
+  uint64_t threads_offset{0};
+  uint64_t sites_offset{0};
+  uint64_t size{0};
+};
+
+// created by the monitored process (read-write),
+// opened by the watchdog (read-only)
+class shared_segment {
+public:
+  static std::string default_name() {
+    return WATCHDOG_SEGMENT_PREFIX + std::to_string(getpid());
+  }
+
+  // one slot per monitored thread and all sites currently registered
+  static std::unique_ptr<shared_segment>
+  create(const std::string &name = default_name(),
+         uint32_t max_threads = MAX_THREADS);
+
+  static std::unique_ptr<shared_segment> open(const std::string &name);
+
+  static bool remove(const std::string &name) {
+    return shm_unlink(name.c_str()) == 0;
+  }
+
+  ~shared_segment() { munmap(m_base, m_size); }
+
+  shared_segment(const shared_segment &) = delete;
+  shared_segment &operator=(const shared_segment &) = delete;
+
+  const std::string &name() const { return m_name; }
+
+  const shared_segment_header &header() const {
+    return *reinterpret_cast<const shared_segment_header *>(m_base);
+  }
+
+  uint32_t max_threads() const { return header().max_threads; }
+
+  shared_thread_slot &slot(uint32_t i) {
+    return at<shared_thread_slot>(header().threads_offset)[i];
+  }
+
+  // nullptr for unregistered checkpoints
+  const shared_site *site(checkpoint_index_t index) {
+    if (index >= header().site_count) {
+      return nullptr;
+    }
+    return &at<shared_site>(header().sites_offset)[index];
+  }
+
+  // slot for the calling thread, nullptr if all are in use
+  shared_thread_slot *claim(os_tid_t os_tid) {
+    for (uint32_t i = 0; i < max_threads(); ++i) {
+      if (slot(i).claim(os_tid)) {
+        return &slot(i);
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  std::string m_name;
+  char *m_base;
+  size_t m_size;
+
+  shared_segment(const std::string &name, void *base, size_t size)
+      : m_name(name), m_base(static_cast<char *>(base)), m_size(size) {}
+
+  template <typename T> T *at(uint64_t offset) {
+    return reinterpret_cast<T *>(m_base + offset);
+  }
+
+  static uint64_t round_up(uint64_t n) { return (n + 63) / 64 * 64; }
+
+  static void copy(char *dest, const char *src) {
+    if (src) {
+      std::strncpy(dest, src, WATCHDOG_SITE_CHARS - 1);
+    }
+  }
+};
+
+inline std::unique_ptr<shared_segment>
+shared_segment::create(const std::string &name, uint32_t max_threads) {
+  auto sites = checkpoint_registry::count();
+  uint64_t threads_offset = round_up(sizeof(shared_segment_header));
+  uint64_t sites_offset =
+      threads_offset + uint64_t(max_threads) * sizeof(shared_thread_slot);
+  uint64_t size = sites_offset + uint64_t(sites) * sizeof(shared_site);
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<shared_segment> segment(new shared_segment(name, p, size));
+  auto header = new (p) shared_segment_header();
+  header->pid = getpid();
+  std::ifstream comm("/proc/self/comm");
+  comm.getline(header->process, sizeof(header->process));
+  header->max_threads = max_threads;
+  header->max_depth = WATCHDOG_MAX_DEPTH;
+  header->site_count = sites;
+  header->threads_offset = threads_offset;
+  header->sites_offset = sites_offset;
+  header->size = size;
+
+  for (uint32_t i = 0; i < max_threads; ++i) {
+    new (&segment->slot(i)) shared_thread_slot();
+  }
+  for (checkpoint_index_t i = 0; i < sites; ++i) {
+    auto &location = checkpoint_registry::location(i);
+    auto s = new (&segment->at<shared_site>(sites_offset)[i]) shared_site();
+    s->line = location.line;
+    copy(s->file, location.file);
+    copy(s->function, location.function);
+  }
+
+  header->magic.store(shared_segment_header::MAGIC, std::memory_order_release);
+  return segment;
+}
+
+inline std::unique_ptr<shared_segment>
+shared_segment::open(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      size_t(st.st_size) < sizeof(shared_segment_header)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = st.st_size;
+  void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::unique_ptr<shared_segment> segment(new shared_segment(name, p, size));
+  auto &header = segment->header();
+  // not (yet) initialized, of another version or truncated
+  if (header.magic.load(std::memory_order_acquire) !=
+          shared_segment_header::MAGIC ||
+      header.max_depth != WATCHDOG_MAX_DEPTH || header.size > size) {
+    return nullptr;
+  }
+  return segment;
+}
+
+} // namespace monitor
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "config.hpp"
+#include "statistics.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace monitor {
+
+// service level objective of a checkpoint, e.g. 99% of the runs of
+// checkpoint 12 within budget,
+// alarms if the error budget burns too fast in a long and a short window
+// (the short window makes the alarm stop soon after the problem is gone)
+struct slo {
+  checkpoint_id_t id{0};
+  // fraction of the runs required to be within budget
+  double objective{0.99};
+  // in window buckets
+  uint32_t long_window{STATS_WINDOW_BUCKETS};
+  uint32_t short_window{STATS_WINDOW_BUCKETS / 12};
+  // 1 means the error budget is used up exactly at the end of the window
+  double burn_rate_threshold{14.4};
+};
+
+struct slo_status {
+  slo objective;
+  totals long_window;
+  totals short_window;
+  double long_burn_rate{0};
+  double short_burn_rate{0};
+  bool alarm{false};
+};
+
+inline double burn_rate(const totals &t, double objective) {
+  if (t.count == 0) {
+    return 0;
+  }
+  double error_ratio = double(t.violations) / t.count;
+  return error_ratio / (1 - objective);
+}
+
+// ring of buckets, each containing what happened at each checkpoint site
+// during one rotation period,
+// computed from the difference of cumulative totals, hence the monitored
+// threads do not know about the windows at all
+class sliding_window {
+public:
+  sliding_window(uint32_t buckets = STATS_WINDOW_BUCKETS)
+      : m_ring(std::max(buckets, 1U)) {}
+
+  void rotate(const totals_table &cumulative) {
+    if (!m_initialized) {
+      // everything before the first rotation is not part of any window
+      m_last = cumulative;
+      m_initialized = true;
+      return;
+    }
+
+    auto &bucket = m_ring[m_head];
+    bucket.assign(cumulative.size(), totals());
+    for (size_t i = 0; i < cumulative.size(); ++i) {
+      auto &now = cumulative[i];
+      auto &delta = bucket[i];
+      delta.id = now.id;
+      if (i < m_last.size()) {
+        auto &before = m_last[i];
+        delta.count = difference(now.count, before.count);
+        delta.violations = difference(now.violations, before.violations);
+        delta.sum = difference(now.sum, before.sum);
+      } else {
+        delta.count = now.count;
+        delta.violations = now.violations;
+        delta.sum = now.sum;
+      }
+    }
+
+    m_last = cumulative;
+    m_head = (m_head + 1) % m_ring.size();
+    m_filled = std::min<uint32_t>(m_filled + 1, m_ring.size());
+  }
+
+  // aggregate over the last n buckets of all sites with the checkpoint id
+  totals aggregate(checkpoint_id_t id, uint32_t n) const {
+    totals result;
+    result.id = id;
+    for_each_bucket(n, [&](const totals_table &bucket) {
+      for (auto &t : bucket) {
+        if (t.id == id) {
+          result.merge(t);
+        }
+      }
+    });
+    return result;
+  }
+
+  // aggregate over the last n buckets of a checkpoint site
+  totals aggregate_site(checkpoint_index_t index, uint32_t n) const {
+    totals result;
+    for_each_bucket(n, [&](const totals_table &bucket) {
+      if (index < bucket.size()) {
+        result.merge(bucket[index]);
+      }
+    });
+    return result;
+  }
+
+  uint32_t size() const { return static_cast<uint32_t>(m_ring.size()); }
+
+  // buckets containing data
+  uint32_t filled() const { return m_filled; }
+
+private:
+  std::vector<totals_table> m_ring;
+  totals_table m_last;
+  uint32_t m_head{0};
+  uint32_t m_filled{0};
+  bool m_initialized{false};
+
+  static uint64_t difference(uint64_t now, uint64_t before) {
+    return now > before ? now - before : 0;
+  }
+
+  template <typename F>
+  void for_each_bucket(uint32_t n, F f) const {
+    n = std::min(n, m_filled);
+    auto size = m_ring.size();
+    for (uint32_t i = 1; i <= n; ++i) {
+      f(m_ring[(m_head + size - i) % size]);
+    }
+  }
+};
+
+// sliding windows of the checkpoint statistics and the SLOs defined on them,
+// rotated by the active monitoring thread (not in the hot path)
+class slo_monitor {
+public:
+  slo_monitor(uint32_t buckets = STATS_WINDOW_BUCKETS) : m_window(buckets) {}
+
+  slo_monitor(const slo_monitor &) = delete;
+
+  void add(const slo &objective) {
+    std::lock_guard<std::mutex> g(m_mutex);
+    m_slos.push_back(slo_status{objective, {}, {}});
+  }
+
+  template <typename Handler>
+  void set_handler(const Handler &handler) {
+    std::lock_guard<std::mutex> lock(m_handler_mutex);
+    m_handler = handler;
+  }
+
+  void unset_handler() {
+    std::lock_guard<std::mutex> lock(m_handler_mutex);
+    m_handler = 0;
+  }
+
+  // advance the windows and evaluate the SLOs, the handler is called
+  // whenever an SLO starts to alarm
+  void rotate(const totals_table &cumulative) {
+    std::vector<slo_status> alarms;
+    {
+      std::lock_guard<std::mutex> g(m_mutex);
+      m_window.rotate(cumulative);
+      for (auto &s : m_slos) {
+        bool was_alarm = s.alarm;
+        evaluate(s);
+        if (s.alarm && !was_alarm) {
+          alarms.push_back(s);
+        }
+      }
+    }
+
+    for (auto &status : alarms) {
+      invoke_handler(status);
+    }
+  }
+
+  std::vector<slo_status> status() {
+    std::lock_guard<std::mutex> g(m_mutex);
+    return m_slos;
+  }
+
+  totals window_totals(checkpoint_id_t id, uint32_t buckets) {
+    std::lock_guard<std::mutex> g(m_mutex);
+    return m_window.aggregate(id, buckets);
+  }
+
+private:
+  std::mutex m_mutex;
+  sliding_window m_window;
+  std::vector<slo_status> m_slos;
+
+  std::mutex m_handler_mutex;
+  std::function<void(slo_status &)> m_handler;
+
+  void evaluate(slo_status &s) {
+    auto &o = s.objective;
+    s.long_window = m_window.aggregate(o.id, o.long_window);
+    s.short_window = m_window.aggregate(o.id, o.short_window);
+    s.long_burn_rate = burn_rate(s.long_window, o.objective);
+    s.short_burn_rate = burn_rate(s.short_window, o.objective);
+    s.alarm = s.long_burn_rate >= o.burn_rate_threshold &&
+              s.short_burn_rate >= o.burn_rate_threshold;
+  }
+
+  void invoke_handler(slo_status &status) {
+    std::lock_guard<std::mutex> lock(m_handler_mutex);
+    if (m_handler)
+      m_handler(status);
+  }
+};
+
+} // namespace monitor
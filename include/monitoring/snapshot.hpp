@@ -0,0 +1,94 @@
+#pragma once
+
+#include "time.hpp"
+#include "types.hpp"
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace monitor {
+
+// what the monitoring thread needs to know about a thread in each tick
+struct deadline_snapshot {
+  // innermost checkpoint
+  time_t deadline{0};
+  checkpoint_id_t id{0};
+  // earliest deadline of all active checkpoints (an enclosing checkpoint
+  // may be due before the innermost one)
+  time_t min_deadline{0};
+  // number of active checkpoints, 0 means nothing to check
+  uint32_t depth{0};
+};
+
+// published by the monitored thread at every push and pop of a deadline,
+// read by the monitoring thread with a seqlock (one cache line, no pointer
+// chasing into the allocator memory of the monitored thread)
+class alignas(64) published_snapshot {
+public:
+  // writer only
+  void publish(const deadline_snapshot &snapshot) {
+    auto seq = m_seq.load(std::memory_order_relaxed);
+    m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_deadline.store(snapshot.deadline, std::memory_order_relaxed);
+    m_id.store(snapshot.id, std::memory_order_relaxed);
+    m_min_deadline.store(snapshot.min_deadline, std::memory_order_relaxed);
+    m_depth.store(snapshot.depth, std::memory_order_relaxed);
+
+    m_seq.store(seq + 2, std::memory_order_release);
+  }
+
+  // fails if the writer publishes concurrently (i.e. makes progress)
+  bool try_load(deadline_snapshot &result) const {
+    auto seq = m_seq.load(std::memory_order_acquire);
+    if (seq % 2 != 0) {
+      return false;
+    }
+
+    result.deadline = m_deadline.load(std::memory_order_relaxed);
+    result.id = m_id.load(std::memory_order_relaxed);
+    result.min_deadline = m_min_deadline.load(std::memory_order_relaxed);
+    result.depth = m_depth.load(std::memory_order_relaxed);
+
+    // ensure the loads happen before we check the sequence again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq == m_seq.load(std::memory_order_relaxed);
+  }
+
+  // writer only
+  void clear() { publish(deadline_snapshot()); }
+
+private:
+  std::atomic<uint64_t> m_seq{0};
+  std::atomic<time_t> m_deadline{0};
+  std::atomic<checkpoint_id_t> m_id{0};
+  std::atomic<time_t> m_min_deadline{0};
+  std::atomic<uint32_t> m_depth{0};
+};
+
+// with MONITORING_MIN_DEADLINE only the earliest deadline of all active
+// checkpoints is published (the top of the min-stack formed by the
+// min_deadline of the stack entries), one store per push and pop and one load
+// per thread and tick, the stack is only walked if it is due
+class alignas(64) published_min_deadline {
+public:
+  // no active checkpoint
+  static constexpr time_t NONE = 0;
+
+  // writer only
+  void publish(time_t min_deadline) {
+    m_min_deadline.store(min_deadline, std::memory_order_release);
+  }
+
+  // writer only
+  void clear() { publish(NONE); }
+
+  time_t load() const { return m_min_deadline.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<time_t> m_min_deadline{NONE};
+};
+
+} // namespace monitor
@@ -1,98 +1,375 @@
 #pragma once
 
 // TODO: refactor dependencies
+#include "checkpoint_registry.hpp"
+#include "config.hpp"
+#include "cpu_time.hpp"
+#include "histogram.hpp"
+#include "perf_counters.hpp"
+#include "path_stats.hpp"
 #include "source_location.hpp"
 #include "time.hpp"
 
 #include "stack/entry.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <limits>
-#include <map>
+#include <memory>
 #include <mutex>
-
-// TODO: optimization,
-// can do this thread local and merge the results later namespace monitor {
+#include <vector>
 
 namespace monitor {
 
+// relative error of the reported percentiles at most 2^-4 = 6.25%,
+// time values of 2^40 time units (~18 minutes in ns) and more are clamped
+using latency_histogram = log_linear_histogram<4, 40>;
+
 struct stats {
 
-  stats(checkpoint_id_t id) : id(id) {}
-  source_location location;
+  stats(checkpoint_id_t id = 0) : id(id) {}
+  source_location location{};
   checkpoint_id_t id{0};
+  checkpoint_kind kind{checkpoint_kind::progress};
 
   uint64_t count{0};
   uint64_t violations{0};
   uint64_t min{std::numeric_limits<uint64_t>::max()};
   uint64_t max{0};
-  double mean{0};
-  double meanOfSquares{0};
+  // integer total, does not lose precision with large counts
+  uint64_t sum{0};
+  latency_histogram histogram;
+  // only with MONITORING_STATS_CPU_TIME
+  cpu_attribution within_budget;
+  cpu_attribution over_budget;
+  // only with MONITORING_STATS_PERF
+  perf_attribution perf;
+
+  // hot path, no floating point arithmetics
+  void update(time_t runtime, bool violation) {
+    if (violation) {
+      ++violations;
+    }
+    ++count;
+
+    if (runtime < min) {
+      min = runtime;
+    }
+    if (runtime > max) {
+      max = runtime;
+    }
+
+    sum += runtime;
+    histogram.record(runtime);
+  }
+
+  void update(time_t runtime, bool violation, const cpu_sample &used) {
+    update(runtime, violation);
+    auto &attribution = violation ? over_budget : within_budget;
+    attribution.update(runtime, used);
+  }
+
+  // counted is nullptr if the counters are not available
+  void update(time_t runtime, bool violation, const perf_sample *counted) {
+    update(runtime, violation);
+    if (counted) {
+      perf.update(*counted);
+    }
+  }
+
+  void update(time_t runtime, bool violation, const cpu_sample &used,
+              const perf_sample *counted) {
+    update(runtime, violation, used);
+    if (counted) {
+      perf.update(*counted);
+    }
+  }
+
+  // combine the statistics of the same checkpoint gathered by another thread
+  void merge(const stats &other) {
+    count += other.count;
+    violations += other.violations;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+    histogram.merge(other.histogram);
+    within_budget.merge(other.within_budget);
+    over_budget.merge(other.over_budget);
+    perf.merge(other.perf);
+  }
+
+  double mean() const { return count > 0 ? double(sum) / count : 0; }
 
-  void print() {
-    std::cout << "checkpoint id " << id << std::endl;
+  // fraction of runs that exceeded the time budget
+  double violation_ratio() const {
+    return count > 0 ? double(violations) / count : 0;
+  }
+
+  // the exact maximum is known, the histogram value only up to its resolution
+  uint64_t percentile(double p) const {
+    return std::min(histogram.value_at_quantile(p / 100), max);
+  }
+
+  void print() const {
+    const char *name = kind == checkpoint_kind::wait ? "wait" : "checkpoint";
+    if (!location.file) {
+      std::cout << "unregistered checkpoints" << std::endl;
+    } else if (count > 0) {
+      std::cout << name << " id " << id << " at " << location << std::endl;
+    } else {
+      std::cout << name << " at " << location << std::endl;
+    }
     std::cout << "count : " << count << std::endl;
-    std::cout << "violations : " << violations << std::endl;
+    std::cout << "violations : " << violations << " ("
+              << 100 * violation_ratio() << " %)" << std::endl;
+    if (count == 0) {
+      return;
+    }
     std::cout << "min : " << min << std::endl;
     std::cout << "max : " << max << std::endl;
-    std::cout << "mean : " << mean << std::endl;
-    std::cout << "standard deviation : " << std::sqrt(variance()) << std::endl;
-  }
-
-  double variance() {
-    if (count < 2) {
-      return 0;
-    }
-    // estimate based on VarX = E[X*X] - E[X]*E[X]
-    // we keep the totals Tk = Sum X_i ^ k, hence
-    // n = count = T0,
-    // mean = T1 / n
-    // meanOfSquares = T2/n
-    // and can then estimate the variance as
-    // C * (n * T2 - T1*T1) / (n*n)
-    // with correction factor for bias
-    // C = n/(n-1)
-    double n = double(count);
-    double m1 = mean;
-    double m2 = meanOfSquares;
-    return (n / (n - 1)) * (m2 - m1 * m1);
+    std::cout << "mean : " << mean() << std::endl;
+    std::cout << "standard deviation : " << std::sqrt(histogram.variance())
+              << std::endl;
+    std::cout << "p50 : " << percentile(50) << std::endl;
+    std::cout << "p90 : " << percentile(90) << std::endl;
+    std::cout << "p99 : " << percentile(99) << std::endl;
+    std::cout << "p99.9 : " << percentile(99.9) << std::endl;
+    within_budget.print("within budget");
+    over_budget.print("over budget");
+    perf.print();
+  }
+};
+
+// indexed by checkpoint site, the last entry collects unregistered checkpoints
+using stats_table = std::vector<stats>;
+
+// cheap subset of the statistics (no histogram)
+struct totals {
+  checkpoint_id_t id{0};
+  uint64_t count{0};
+  uint64_t violations{0};
+  uint64_t sum{0};
+
+  void merge(const totals &other) {
+    if (other.count > 0) {
+      id = other.id;
+    }
+    count += other.count;
+    violations += other.violations;
+    sum += other.sum;
+  }
+};
+
+using totals_table = std::vector<totals>;
+
+// statistics of a single thread, there is exactly one writer (the thread
+// itself) which never waits for anything,
+// readers (merging the statistics) take a seqlock style snapshot of each
+// checkpoint and retry if the writer modified it concurrently
+class local_stats {
+public:
+  // preallocated for all checkpoint sites in the binary
+  local_stats() : local_stats(checkpoint_registry::count() + 1) {}
+
+  explicit local_stats(uint32_t size)
+      : m_size(size), m_slots(std::make_unique<slot[]>(m_size)) {
+    clear();
+  }
+
+  local_stats(const local_stats &) = delete;
+
+  void update(checkpoint_index_t index, checkpoint_id_t id, time_t runtime,
+              bool violation) {
+    auto &s = begin_write(index);
+    s.value.id = id;
+    s.value.update(runtime, violation);
+    end_write(s);
+  }
+
+  void update(checkpoint_index_t index, checkpoint_id_t id, time_t runtime,
+              bool violation, const cpu_sample &used) {
+    auto &s = begin_write(index);
+    s.value.id = id;
+    s.value.update(runtime, violation, used);
+    end_write(s);
+  }
+
+  void update(checkpoint_index_t index, checkpoint_id_t id, time_t runtime,
+              bool violation, const perf_sample *counted) {
+    auto &s = begin_write(index);
+    s.value.id = id;
+    s.value.update(runtime, violation, counted);
+    end_write(s);
+  }
+
+  void update(checkpoint_index_t index, checkpoint_id_t id, time_t runtime,
+              bool violation, const cpu_sample &used,
+              const perf_sample *counted) {
+    auto &s = begin_write(index);
+    s.value.id = id;
+    s.value.update(runtime, violation, used, counted);
+    end_write(s);
+  }
+
+  // merge a consistent snapshot of each checkpoint into result,
+  // never blocks the writer (but may have to retry)
+  void merge_into(stats_table &result) {
+    if (result.size() < m_size) {
+      result.resize(m_size);
+    }
+
+    stats snapshot;
+    for (uint32_t i = 0; i < m_size; ++i) {
+      while (!try_load(m_slots[i], snapshot))
+        ;
+      merge(result[i], snapshot);
+    }
+  }
+
+  // like merge_into but only the totals (much less to copy)
+  void merge_totals_into(totals_table &result) {
+    if (result.size() < m_size) {
+      result.resize(m_size);
+    }
+
+    totals snapshot;
+    for (uint32_t i = 0; i < m_size; ++i) {
+      while (!try_load(m_slots[i], snapshot))
+        ;
+      result[i].merge(snapshot);
+    }
+  }
+
+  uint32_t size() { return m_size; }
+
+  // only allowed if there are no concurrent readers and writers
+  void clear() {
+    for (uint32_t i = 0; i < m_size; ++i) {
+      auto &value = m_slots[i].value;
+      value = stats();
+      if (i < checkpoint_registry::count()) {
+        value.location = checkpoint_registry::location(i);
+        value.kind = checkpoint_registry::kind(i);
+      }
+    }
+  }
+
+  // merge statistics of the same checkpoint site
+  static void merge(stats &result, const stats &other) {
+    result.location = other.location;
+    result.kind = other.kind;
+    if (other.count > 0) {
+      result.id = other.id;
+    }
+    result.merge(other);
+  }
+
+private:
+  struct slot {
+    std::atomic<uint64_t> seq{0};
+    stats value;
+  };
+
+  uint32_t m_size;
+  std::unique_ptr<slot[]> m_slots;
+
+  slot &begin_write(checkpoint_index_t index) {
+    // unregistered or registered after the thread started (e.g. dlopen)
+    if (index >= m_size) {
+      index = m_size - 1;
+    }
+    auto &s = m_slots[index];
+
+    // odd sequence number - modification in progress
+    auto seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return s;
+  }
+
+  void end_write(slot &s) {
+    // even sequence number - data is consistent
+    auto seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_release);
+  }
+
+  bool try_load(slot &s, stats &result) {
+    auto seq = s.seq.load(std::memory_order_acquire);
+    if (seq % 2 != 0) {
+      return false; // concurrent modification
+    }
+
+    result = s.value;
+
+    // ensure the copy happens before we check the sequence again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq == s.seq.load(std::memory_order_relaxed);
+  }
+
+  bool try_load(slot &s, totals &result) {
+    auto seq = s.seq.load(std::memory_order_acquire);
+    if (seq % 2 != 0) {
+      return false; // concurrent modification
+    }
+
+    result.id = s.value.id;
+    result.count = s.value.count;
+    result.violations = s.value.violations;
+    result.sum = s.value.sum;
+
+    // ensure the copy happens before we check the sequence again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq == s.seq.load(std::memory_order_relaxed);
   }
 };
 
+// accumulates the statistics of threads that stopped monitoring,
+// never used in the hot path (only at deregistration and output)
 class stats_monitor {
 public:
-  static void update(checkpoint_id_t id, time_t runtime,
-                     bool violation = false) {
+  static void retire(local_stats &local) {
+    auto &inst = instance();
+    std::lock_guard<std::mutex> g(inst.m_mutex);
+    local.merge_into(inst.m_stats);
+  }
 
-    // TODO: avoid these blocking between unrelated threads
-    // and gather stats in local maps and merge them when the threads
-    // end
+  static void retire(local_paths &local) {
     auto &inst = instance();
     std::lock_guard<std::mutex> g(inst.m_mutex);
-    auto &stats = inst.get(id);
+    local.merge_into(inst.m_paths);
+  }
 
-    if (violation) {
-      ++stats.violations;
+  static void merge_paths_into(path_profile &result) {
+    auto &inst = instance();
+    std::lock_guard<std::mutex> g(inst.m_mutex);
+    for (auto &p : inst.m_paths) {
+      result[p.first].merge(p.second);
     }
-    ++stats.count;
+  }
 
-    if (runtime < stats.min) {
-      stats.min = runtime;
+  static void merge_totals_into(totals_table &result) {
+    auto &inst = instance();
+    std::lock_guard<std::mutex> g(inst.m_mutex);
+    if (result.size() < inst.m_stats.size()) {
+      result.resize(inst.m_stats.size());
     }
-    if (runtime > stats.max) {
-      stats.max = runtime;
+    for (size_t i = 0; i < inst.m_stats.size(); ++i) {
+      auto &s = inst.m_stats[i];
+      result[i].merge(totals{s.id, s.count, s.violations, s.sum});
     }
+  }
 
-    // incremental computation of mean and variance
-
-    double t = double(runtime);
-    double n = stats.count;
-    auto m1 = stats.mean;
-    stats.mean = (t + (n - 1) * m1) / n;
-
-    auto m2 = stats.meanOfSquares;
-    stats.meanOfSquares = (t * t + (n - 1) * m2) / n;
+  static void merge_into(stats_table &result) {
+    auto &inst = instance();
+    std::lock_guard<std::mutex> g(inst.m_mutex);
+    if (result.size() < inst.m_stats.size()) {
+      result.resize(inst.m_stats.size());
+    }
+    for (size_t i = 0; i < inst.m_stats.size(); ++i) {
+      local_stats::merge(result[i], inst.m_stats[i]);
+    }
   }
 
   static stats_monitor &instance() {
@@ -100,12 +377,13 @@ public:
     return instance;
   }
 
-  static void print() {
-    auto &inst = instance();
-    std::lock_guard<std::mutex> g(inst.m_mutex);
-    for (auto &pair : inst.m_stats) {
-      pair.second.print();
-      std::cout << std::endl;
+  // all checkpoint sites, including the ones that were never reached
+  static void print(stats_table &stats) {
+    for (auto &s : stats) {
+      if (s.location.file || s.count > 0) {
+        s.print();
+        std::cout << std::endl;
+      }
     }
   }
 
@@ -114,18 +392,8 @@ private:
   stats_monitor(const stats_monitor &) = delete;
 
   std::mutex m_mutex;
-  std::map<checkpoint_id_t, stats> m_stats;
-
-  stats &get(checkpoint_id_t id) {
-
-    auto iter = m_stats.find(id);
-    if (iter != m_stats.end()) {
-      return iter->second;
-    }
-    // TODO: can actually fail, need to handle this
-    auto pair = m_stats.emplace(std::make_pair(id, stats(id)));
-    return (pair.first)->second;
-  }
+  stats_table m_stats;
+  path_profile m_paths;
 };
 
-} // namespace monitor
\ No newline at end of file
+} // namespace monitor
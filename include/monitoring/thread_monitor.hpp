@@ -1,6 +1,9 @@
 #pragma once
 
+#include "budget.hpp"
+#include "monitor_stats.hpp"
 #include "report.hpp"
+#include "slo.hpp"
 #include "stack/entry.hpp"
 #include "thread_state.hpp"
 #include "time.hpp"
@@ -12,13 +15,37 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <list>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace monitor {
 
+// monitoring of the monitor itself (e.g. for exporters)
+struct monitor_health {
+  uint32_t registered_threads{0};
+  // detected by the monitoring thread
+  uint64_t active_violations{0};
+  // detected by the monitored threads themselves
+  uint64_t passive_violations{0};
+  bool active{false};
+};
+
+// a violation detected by the monitoring thread
+struct violation_record {
+  checkpoint_id_t id{0};
+  source_location location{};
+  os_tid_t os_tid{0};
+  // time units the deadline was exceeded at detection
+  time_t delta{0};
+  // only with MONITORING_SCHED_STATE
+  sched_state sched;
+};
+
 class thread_monitor {
   static constexpr uint32_t Capacity = MAX_THREADS;
 
@@ -36,7 +63,11 @@ public:
     };
   }
 
-  ~thread_monitor() {}
+  ~thread_monitor() {
+    if (m_shared) {
+      shared_segment::remove(m_shared->name());
+    }
+  }
 
   thread_state *register_this_thread() {
     std::lock_guard<thread_monitor> g(*this);
@@ -64,11 +95,104 @@ public:
     m_free.push(index);
   }
 
+#ifdef MONITORING_STATS
+  // merged statistics of all threads (past and currently monitored),
+  // does not block the monitored threads
+  stats_table collect_stats() {
+    stats_table result;
+    std::lock_guard<thread_monitor> g(*this);
+    stats_monitor::merge_into(result);
+    for (auto state : m_registered) {
+      state->stats->merge_into(result);
+    }
+    return result;
+  }
+
+  totals_table collect_totals() {
+    totals_table result;
+    std::lock_guard<thread_monitor> g(*this);
+    stats_monitor::merge_totals_into(result);
+    for (auto state : m_registered) {
+      state->stats->merge_totals_into(result);
+    }
+    return result;
+  }
+
+  // self and inclusive time of the checkpoint paths of all threads
+  path_profile collect_paths() {
+    path_profile result;
+    std::lock_guard<thread_monitor> g(*this);
+    stats_monitor::merge_paths_into(result);
+    for (auto state : m_registered) {
+      state->paths->merge_into(result);
+    }
+    return result;
+  }
+
+  // windows only advance while active monitoring runs
+  slo_monitor &slos() { return m_slos; }
+
+  // derive budgets from the statistics gathered so far,
+  // returns the number of calibrated sites
+  uint32_t calibrate_budgets(const calibration_config &config) {
+    auto table = collect_stats();
+    return calibrate(m_budgets, table, config);
+  }
+
+  // the active monitoring thread recalibrates the budgets periodically
+  void start_budget_adaptation(const calibration_config &config) {
+    std::lock_guard<thread_monitor> g(*this);
+    m_calibration = config;
+    m_next_calibration = clock_t::now() + config.interval;
+    m_adapting = true;
+  }
+
+  void stop_budget_adaptation() {
+    std::lock_guard<thread_monitor> g(*this);
+    m_adapting = false;
+  }
+#endif
+
+  // overrides of the literal budgets, used in the hot path
+  budget_table &budgets() { return m_budgets; }
+
+  // reloaded by the active monitoring thread on request (e.g. a signal)
+  void set_budget_file(const std::string &path) {
+    std::lock_guard<thread_monitor> g(*this);
+    m_budget_file = path;
+  }
+
+  // mirrors the deadline stacks of the threads registered afterwards into a
+  // shared memory segment which an out-of-process watchdog can check,
+  // the segment is removed with the monitor
+  bool export_to_watchdog(const std::string &name) {
+    std::lock_guard<thread_monitor> g(*this);
+    if (m_shared) {
+      return false;
+    }
+    m_shared = shared_segment::create(name, Capacity);
+    return m_shared != nullptr;
+  }
+
+  // records the last events of the threads registered afterwards in a
+  // memory mapped file which survives the process
+  bool record_flight(const std::string &path, uint32_t events) {
+    std::lock_guard<thread_monitor> g(*this);
+    if (m_recorder) {
+      return false;
+    }
+    m_recorder = flight_recorder::create(path, events, Capacity);
+    return m_recorder != nullptr;
+  }
+
   void start_active_monitoring(time_unit_t interval) {
     if (!m_active) {
       m_max_interval = interval;
       m_interval = interval;
       m_active = true;
+#ifdef MONITORING_STATS
+      m_next_rotation = clock_t::now();
+#endif
 
       m_thread = std::thread(&thread_monitor::monitor_loop, this);
       prioritize(m_thread);
@@ -93,12 +217,144 @@ public:
     m_condvar.notify_one();
   }
 
+  // one scan of all registered threads, called by the monitoring thread
+  // (or directly, e.g. to benchmark the scan), returns the earliest deadline
+  // that is not due yet
+  time_t check_deadlines(const std::chrono::time_point<clock_t> &checktime) {
+    auto time = to_time_unit(checktime);
+
+    // this lock is weakly contended (only at registration/deregistration)
+    // TODO: do we need to optimize here?
+    std::unique_lock<thread_monitor> lock(*this);
+
+    auto min_deadline = std::numeric_limits<time_t>::max();
+    m_tick = monitor_tick();
+    m_tick.registered_threads = static_cast<uint32_t>(m_registered.size());
+
+    // TODO: optimize iteration structure
+    for (auto state : m_registered) {
+      // O(1) per thread unless a deadline may be violated
+#ifdef MONITORING_MIN_DEADLINE
+      // a single load, the walk below copes with a concurrent push or pop
+      auto due = state->snapshot.load();
+      if (due == published_min_deadline::NONE) {
+        continue;
+      }
+#else
+      deadline_snapshot snapshot;
+      if (!state->snapshot.try_load(snapshot)) {
+        // the thread pushes or pops a deadline, check in the next tick
+        ++m_tick.aborted_scans;
+        continue;
+      }
+      if (snapshot.depth == 0) {
+        continue;
+      }
+      auto due = snapshot.min_deadline;
+#endif
+      if (!is_earlier(due, time)) {
+        if (due < min_deadline) {
+          min_deadline = due;
+        }
+        continue;
+      }
+
+      // a violation is suspected, walk the stack
+      auto &stack = state->deadlines;
+
+      // TODO: analyze whether stronger fences are needed!
+      auto old_count = stack.count();
+
+      auto entry = stack.top();
+
+      // we check the stack entries for violations
+      // TODO: skip unnecessary checks (known violations), but this requires
+      // a more complex way of storing the violations (worth it?)...
+      time_t deadline;
+      while (entry) {
+        bool continue_checking =
+            check_entry(*state, *entry, old_count, time, deadline);
+
+        if (continue_checking) {
+          entry = entry->next;
+        } else if (old_count == stack.count() &&
+                   is_earlier(entry->data.min_deadline, time)) {
+          // an enclosing deadline is due before this one
+          entry = entry->next;
+        } else {
+          if (deadline < min_deadline) {
+            min_deadline = deadline;
+          }
+          break;
+        }
+      }
+    }
+
+#ifdef MONITORING_SCHED_STATE
+    // neither the handlers nor the registration of threads wait for /proc
+    std::vector<sched_sample> samples;
+    samples.swap(m_sched_samples);
+    lock.unlock();
+    sample_sched_states(samples);
+#endif
+
+    return min_deadline;
+  }
+
+  // counts of the last scan
+  const monitor_tick &last_tick() const { return m_tick; }
+
+  // the handler of the monitoring thread, set it before the active monitoring
+  // starts
+  template <typename Handler> void set_handler(const Handler &handler) {
+    m_handler = handler;
+  }
+
+  void unset_handler() { m_handler = 0; }
+
   // TODO: concurrency assumptions
   void invoke_handler(checkpoint &check) {
     if (m_handler)
       m_handler(check);
   }
 
+  // only in case of a violation, contention is no issue
+  void count_passive_violation() {
+    m_passive_violations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // what the active monitoring thread observed so far
+  monitor_stats self_stats() {
+    std::lock_guard<std::mutex> g(m_self_mutex);
+    return m_self_stats;
+  }
+
+  void clear_self_stats() {
+    std::lock_guard<std::mutex> g(m_self_mutex);
+    m_self_stats.clear();
+  }
+
+  // at most MAX_VIOLATION_RECORDS, the oldest first
+  std::vector<violation_record> recent_violations() {
+    std::lock_guard<std::mutex> g(m_violation_mutex);
+    return std::vector<violation_record>(m_violations.begin(),
+                                         m_violations.end());
+  }
+
+  monitor_health health() {
+    monitor_health result;
+    {
+      std::lock_guard<thread_monitor> g(*this);
+      result.registered_threads = static_cast<uint32_t>(m_registered.size());
+    }
+    result.active_violations =
+        m_active_violations.load(std::memory_order_relaxed);
+    result.passive_violations =
+        m_passive_violations.load(std::memory_order_relaxed);
+    result.active = m_active;
+    return result;
+  }
+
 private:
   // weakly contended, only for registration and deregistration
   // resgitration without mutex but only atomics is complicated
@@ -122,18 +378,100 @@ private:
 
   std::function<void(checkpoint &)> m_handler;
 
+  std::atomic<uint64_t> m_active_violations{0};
+  std::atomic<uint64_t> m_passive_violations{0};
+
+  budget_table m_budgets;
+  // protected by m_mutex
+  std::string m_budget_file;
+
+  // only written by the monitoring thread, the separate mutex keeps queries
+  // from delaying registration (and vice versa)
+  std::mutex m_self_mutex;
+  monitor_stats m_self_stats;
+  // of the current scan
+  monitor_tick m_tick;
+
+  std::mutex m_violation_mutex;
+  std::deque<violation_record> m_violations;
+  // of the next violation record, protected by m_violation_mutex
+  uint64_t m_next_record{0};
+
+#ifdef MONITORING_SCHED_STATE
+  // late threads of the current scan, sampled after it (protected by m_mutex)
+  struct sched_sample {
+    uint64_t record;
+    os_tid_t os_tid;
+  };
+  std::vector<sched_sample> m_sched_samples;
+#endif
+
+  // protected by m_mutex
+  std::unique_ptr<shared_segment> m_shared;
+  std::unique_ptr<flight_recorder> m_recorder;
+
+#ifdef MONITORING_STATS
+  slo_monitor m_slos;
+  std::chrono::time_point<clock_t> m_next_rotation;
+  const std::chrono::milliseconds m_window_resolution{
+      STATS_WINDOW_RESOLUTION_MS};
+
+  // protected by m_mutex
+  calibration_config m_calibration;
+  std::chrono::time_point<clock_t> m_next_calibration;
+  bool m_adapting{false};
+#endif
+
   thread_state &get_state(index_t index) { return m_states[index]; }
 
   void init(thread_state &state) {
     state.tid = std::this_thread::get_id();
+    state.os_tid = this_os_tid();
     state.monitor = this;
+    state.depth = 0;
+    state.snapshot.clear();
+    state.shared = m_shared ? m_shared->claim(state.os_tid) : nullptr;
+    state.recorder = m_recorder ? m_recorder->claim(state.os_tid) : nullptr;
+#ifdef MONITORING_STATS
+    // allocated once per slot, not in the hot path
+    if (!state.stats) {
+      state.stats = std::make_unique<local_stats>();
+      state.paths = std::make_unique<local_paths>();
+    }
+#endif
+#ifdef MONITORING_STATS_PERF
+    // the counters belong to the registering thread
+    state.perf = std::make_unique<perf_counters>(stats_perf_events());
+    state.perf->start();
+#endif
   }
 
   void deinit(thread_state &state) {
     state.tid = thread_id_t();
+    state.os_tid = 0;
     // TODO: stack winks out, ok since thread local allocator will also go in
     // normal use case otherwise we must return the entries to the allocator
     state.deadlines.clear();
+    state.depth = 0;
+    state.snapshot.clear();
+    if (state.shared) {
+      state.shared->release();
+      state.shared = nullptr;
+    }
+    if (state.recorder) {
+      state.recorder->release();
+      state.recorder = nullptr;
+    }
+#ifdef MONITORING_STATS
+    // keep the results of the thread
+    stats_monitor::retire(*state.stats);
+    stats_monitor::retire(*state.paths);
+    state.stats->clear();
+    state.paths->clear();
+#endif
+#ifdef MONITORING_STATS_PERF
+    state.perf.reset();
+#endif
   }
 
   void prioritize(std::thread &thread) {
@@ -151,52 +489,110 @@ private:
     }
   }
 
-  time_t check_deadlines(const std::chrono::time_point<clock_t> &checktime) {
-    auto time = to_time_unit(checktime);
-
-    // this lock is weakly contended (only at registration/deregistration)
-    // TODO: do we need to optimize here?
-    std::lock_guard<thread_monitor> g(*this);
-
-    auto min_deadline = std::numeric_limits<time_t>::max();
+  void sleep() {}
 
-    // TODO: optimize iteration structure
-    for (auto state : m_registered) {
-      auto &stack = state->deadlines;
+#ifdef MONITORING_STATS
+  // at most one rotation per loop iteration, rotations that are due
+  // meanwhile are added as empty buckets
+  void rotate_windows(const std::chrono::time_point<clock_t> &now) {
+    if (now < m_next_rotation) {
+      return;
+    }
+    auto cumulative = collect_totals();
+    m_slos.rotate(cumulative);
+    m_next_rotation += m_window_resolution;
+    while (m_next_rotation <= now) {
+      m_slos.rotate(cumulative);
+      m_next_rotation += m_window_resolution;
+    }
+  }
 
-      // TODO: analyze whether stronger fences are needed!
-      auto old_count = stack.count();
+  void adapt_budgets(const std::chrono::time_point<clock_t> &now) {
+    calibration_config config;
+    {
+      std::lock_guard<thread_monitor> g(*this);
+      if (!m_adapting || now < m_next_calibration) {
+        return;
+      }
+      config = m_calibration;
+      m_next_calibration = now + config.interval;
+    }
+    calibrate_budgets(config);
+  }
+#endif
 
-      auto entry = stack.top();
+  // only called by the monitoring thread
+  void reload_requested_budgets() {
+    if (!detail::budget_reload_requested.exchange(false,
+                                                  std::memory_order_relaxed)) {
+      return;
+    }
+    std::string path;
+    {
+      std::lock_guard<thread_monitor> g(*this);
+      path = m_budget_file;
+    }
+    if (!path.empty() && !m_budgets.reload(path)) {
+      std::cerr << "MONITORING ERROR - cannot reload budgets from " << path
+                << std::endl;
+    }
+  }
 
-      // we check the stack entries for violations
-      // TODO: skip unnecessary checks (known violations), but this requires
-      // a more complex way of storing the violations (worth it?)...
-      time_t deadline;
-      while (entry) {
-        bool continue_checking =
-            check_entry(*state, *entry, old_count, time, deadline);
+  // only called by the monitoring thread
+  void record_violation(thread_state &state, checkpoint &check,
+                        time_t delta) {
+    violation_record record;
+    record.id = check.id;
+    record.location = check.location;
+    record.os_tid = state.os_tid;
+    record.delta = delta;
+
+    std::lock_guard<std::mutex> g(m_violation_mutex);
+    if (m_violations.size() >= MAX_VIOLATION_RECORDS) {
+      m_violations.pop_front();
+    }
+    m_violations.push_back(record);
+#ifdef MONITORING_SCHED_STATE
+    m_sched_samples.push_back({m_next_record, state.os_tid});
+#endif
+    ++m_next_record;
+  }
 
-        if (continue_checking) {
-          entry = entry->next;
-        } else {
-          if (deadline < min_deadline) {
-            min_deadline = deadline;
-          }
-          break;
-        }
+#ifdef MONITORING_SCHED_STATE
+  // the late threads are (most likely) still late
+  void sample_sched_states(const std::vector<sched_sample> &samples) {
+    for (auto &sample : samples) {
+      auto sched = read_sched_state(sample.os_tid);
+#ifdef DEADLINE_VIOLATION_OUTPUT_ON
+      if (sched.state) {
+        std::cout << "[Monitoring thread] late thread " << sample.os_tid << " "
+                  << sched << std::endl;
+      }
+#endif
+      std::lock_guard<std::mutex> g(m_violation_mutex);
+      // unless the record was dropped meanwhile
+      auto first = m_next_record - m_violations.size();
+      if (sample.record >= first) {
+        m_violations[sample.record - first].sched = sched;
       }
     }
-
-    return min_deadline;
   }
-
-  void sleep() {}
+#endif
 
   void monitor_loop() {
     while (m_active) {
       auto now = clock_t::now();
       auto min = check_deadlines(now);
+      m_tick.scan_duration = to_time_unit(clock_t::now()) - to_time_unit(now);
+      {
+        std::lock_guard<std::mutex> g(m_self_mutex);
+        m_self_stats.record(m_tick);
+      }
+      reload_requested_budgets();
+#ifdef MONITORING_STATS
+      rotate_windows(now);
+      adapt_budgets(now);
+#endif
 
       auto d = to_deadline(m_interval);
 
@@ -215,8 +611,10 @@ private:
                    time_t time, time_t &deadline) {
     auto &stack = state.deadlines;
     deadline = entry.data.deadline.load(std::memory_order_relaxed);
+    ++m_tick.entries_walked;
 
     if (old_count != stack.count()) {
+      ++m_tick.aborted_scans;
       return false; // stack changed (push or pop of a deadline), skip check
                     // for this iteration
     }
@@ -235,6 +633,12 @@ private:
       if (entry.data.deadline_validator.compare_exchange_strong(
               deadline, deadline + 1, std::memory_order_acq_rel,
               std::memory_order_relaxed)) {
+        m_active_violations.fetch_add(1, std::memory_order_relaxed);
+        {
+          std::lock_guard<std::mutex> g(m_self_mutex);
+          m_self_stats.record_detection(delta);
+        }
+        record_violation(state, entry.data, delta);
         monitoring_thread_report_violation(state, entry.data, delta);
         invoke_handler(entry.data);
         return true;
@@ -1,10 +1,17 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 
 #include "stack/stack.hpp"
+#include "flight_recorder.hpp"
+#include "path_stats.hpp"
+#include "sched_state.hpp"
+#include "shared_segment.hpp"
+#include "snapshot.hpp"
+#include "statistics.hpp"
 
 namespace monitor {
 
@@ -19,12 +26,37 @@ struct thread_state {
   // nested functions require a lock-free stack,
   // suitable for one writer and one concurrent reader
   deadline_stack deadlines;
+  // summary of the stack for the monitoring thread
+#ifdef MONITORING_MIN_DEADLINE
+  published_min_deadline snapshot;
+#else
+  published_snapshot snapshot;
+#endif
+  // only used by the thread itself
+  uint32_t depth{0};
+  // mirror for the out-of-process watchdog, nullptr if not exported
+  shared_thread_slot *shared{nullptr};
+  // last events in a file, nullptr if not recorded
+  flight_ring *recorder{nullptr};
+
   thread_id_t tid{0};
+  // for /proc, 0 if not registered
+  os_tid_t os_tid{0};
 
   index_t index;
 
   thread_monitor *monitor{nullptr};
 
+#ifdef MONITORING_STATS
+  // only written by the monitored thread itself
+  std::unique_ptr<local_stats> stats;
+  std::unique_ptr<local_paths> paths;
+#endif
+#ifdef MONITORING_STATS_PERF
+  // counters of the registered thread, opened at registration
+  std::unique_ptr<perf_counters> perf;
+#endif
+
   thread_state() = default;
   thread_state(const thread_state &other) = delete;
 
@@ -29,4 +29,9 @@ inline bool is_violated(time_t deadline, time_t now, time_t &delta) {
   return d > 0;
 }
 
+// whether deadline a is before deadline b (same restrictions as above)
+inline bool is_earlier(time_t a, time_t b) {
+  return static_cast<stime_t>(a - b) < 0;
+}
+
 } // namespace monitor
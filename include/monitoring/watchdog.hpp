@@ -0,0 +1,196 @@
+#pragma once
+
+#include "sched_state.hpp"
+#include "shared_segment.hpp"
+#include "time.hpp"
+#include "types.hpp"
+
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace monitor {
+
+// a deadline violation in another process
+struct watchdog_violation {
+  int32_t pid;
+  std::string process;
+  os_tid_t os_tid;
+  checkpoint_id_t id;
+  // empty for unregistered checkpoints
+  std::string file;
+  uint32_t line;
+  std::string function;
+  // nesting level of the violated checkpoint (0 is the outermost)
+  uint32_t level;
+  time_t delta;
+};
+
+inline std::ostream &operator<<(std::ostream &out,
+                                const watchdog_violation &v) {
+  out << "deadline violation in process " << v.pid << " (" << v.process
+      << ") thread " << v.os_tid << " checkpoint id " << v.id << " at ";
+  if (v.file.empty()) {
+    out << "unregistered checkpoint";
+  } else {
+    out << v.file << ":" << v.line << " " << v.function;
+  }
+  return out << " level " << v.level << " late by " << v.delta;
+}
+
+// runs the deadline checks of the active monitoring thread for the
+// shared segments of many processes (one watchdog per node instead of one
+// monitoring thread per process), detects stalls of whole processes
+class watchdog {
+public:
+  // returns false if the segment cannot be opened (or is already watched)
+  bool watch(const std::string &name) {
+    if (m_watched.count(name)) {
+      return false;
+    }
+    auto segment = shared_segment::open(name);
+    if (!segment) {
+      return false;
+    }
+    m_watched.emplace(name, watched(std::move(segment)));
+    return true;
+  }
+
+  void unwatch(const std::string &name) { m_watched.erase(name); }
+
+  // watches all new segments with the prefix in /dev/shm,
+  // returns the number of newly watched segments
+  size_t discover(const std::string &prefix = WATCHDOG_SEGMENT_PREFIX);
+
+  size_t size() const { return m_watched.size(); }
+
+  // new violations since the last check, each violated deadline is
+  // reported once
+  std::vector<watchdog_violation> check(time_t now);
+
+  std::vector<watchdog_violation> check() {
+    return check(to_time_unit(clock_t::now()));
+  }
+
+  // stops watching the segments of terminated processes and removes them
+  // (their owner cannot), returns the pids
+  std::vector<int32_t> reap();
+
+private:
+  struct watched {
+    explicit watched(std::unique_ptr<shared_segment> s)
+        : segment(std::move(s)), reported(segment->max_threads()),
+          reported_deep(segment->max_threads(), 0) {}
+
+    std::unique_ptr<shared_segment> segment;
+    // last reported deadline per thread slot and level
+    std::vector<std::array<time_t, WATCHDOG_MAX_DEPTH>> reported;
+    // last reported deadline per thread slot beyond the mirrored levels
+    std::vector<time_t> reported_deep;
+  };
+
+  std::map<std::string, watched> m_watched;
+
+  void check(watched &w, time_t now, std::vector<watchdog_violation> &result);
+};
+
+inline size_t watchdog::discover(const std::string &prefix) {
+  // shm_open names map to /dev/shm/<name without the leading slash>
+  auto file_prefix = prefix.substr(prefix.find_first_not_of('/'));
+  auto dir = opendir("/dev/shm");
+  if (!dir) {
+    return 0;
+  }
+  size_t added = 0;
+  while (auto e = readdir(dir)) {
+    if (std::strncmp(e->d_name, file_prefix.c_str(), file_prefix.size()) ==
+            0 &&
+        watch(std::string("/") + e->d_name)) {
+      ++added;
+    }
+  }
+  closedir(dir);
+  return added;
+}
+
+inline std::vector<watchdog_violation> watchdog::check(time_t now) {
+  std::vector<watchdog_violation> result;
+  for (auto &w : m_watched) {
+    check(w.second, now, result);
+  }
+  return result;
+}
+
+inline void watchdog::check(watched &w, time_t now,
+                            std::vector<watchdog_violation> &result) {
+  auto &segment = *w.segment;
+  auto &header = segment.header();
+  shared_thread_slot::snapshot s;
+
+  for (uint32_t i = 0; i < segment.max_threads(); ++i) {
+    auto &slot = segment.slot(i);
+    if (!slot.used()) {
+      continue;
+    }
+    // the thread is making progress if it pushes or pops concurrently
+    if (!slot.try_load(s) || s.depth == 0 || !is_earlier(s.min_deadline, now)) {
+      continue;
+    }
+
+    auto &reported = w.reported[i];
+    auto n = s.mirrored();
+    bool mirrored_due = false;
+    for (uint32_t level = 0; level < n; ++level) {
+      auto &e = s.entries[level];
+      if (e.deadline == s.min_deadline) {
+        mirrored_due = true;
+      }
+      if (!is_earlier(e.deadline, now) || reported[level] == e.deadline) {
+        continue;
+      }
+      reported[level] = e.deadline;
+
+      watchdog_violation v{header.pid, header.process, s.os_tid, e.id,
+                           "", 0, "", level, now - e.deadline};
+      if (auto site = segment.site(e.index)) {
+        v.file = site->file;
+        v.line = site->line;
+        v.function = site->function;
+      }
+      result.push_back(std::move(v));
+    }
+
+    // the due deadline is of a level that is not mirrored, only the depth is
+    // known (reported as the innermost level, the checkpoint is unknown)
+    if (!mirrored_due && w.reported_deep[i] != s.min_deadline) {
+      w.reported_deep[i] = s.min_deadline;
+      result.push_back({header.pid, header.process, s.os_tid, 0, "", 0, "",
+                        s.depth - 1, now - s.min_deadline});
+    }
+  }
+}
+
+inline std::vector<int32_t> watchdog::reap() {
+  std::vector<int32_t> result;
+  for (auto it = m_watched.begin(); it != m_watched.end();) {
+    auto pid = it->second.segment->header().pid;
+    if (kill(pid, 0) != 0 && errno == ESRCH) {
+      result.push_back(pid);
+      shared_segment::remove(it->first);
+      it = m_watched.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return result;
+}
+
+} // namespace monitor
@@ -3,6 +3,9 @@
 #include <atomic>
 #include <stdint.h>
 
+#include "monitoring/config.hpp"
+#include "monitoring/cpu_time.hpp"
+#include "monitoring/perf_counters.hpp"
 #include "monitoring/source_location.hpp"
 #include "types.hpp"
 
@@ -15,10 +18,24 @@ namespace monitor {
 struct checkpoint {
   source_location location;
   checkpoint_id_t id;
+  checkpoint_index_t index;
   std::atomic<time_t> deadline{0};
   // only if both are the same, the deadline is valid
   std::atomic<time_t> deadline_validator{1};
+  // earliest deadline of this and all enclosing checkpoints
+  time_t min_deadline;
   time_point_t start;
+#ifdef MONITORING_STATS
+  path_index_t path;
+  // inclusive time of the nested checkpoints
+  time_t children;
+#endif
+#ifdef MONITORING_STATS_CPU_TIME
+  cpu_sample cpu_start;
+#endif
+#ifdef MONITORING_STATS_PERF
+  perf_sample perf_start;
+#endif
 
   bool is_valid(time_t assumed_deadline) {
     // a change of deadline can be tolerated by the algorithm (TODO: proof)
@@ -64,7 +64,7 @@ public:
       std::atomic_thread_fence(std::memory_order_acquire);
 
       // m_top may change but memcpy will succeed (potentially with garbage)
-      std::memcpy(&result, &p, sizeof(stack_entry));
+      std::memcpy(static_cast<void *>(&result), p, sizeof(stack_entry));
 
       // potentially redundant but issues no instruction on x86
       std::atomic_thread_fence(std::memory_order_release);
@@ -1,5 +1,8 @@
+#pragma once
+
 #include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 
@@ -139,8 +142,8 @@ void sw_atomic_state<T>::set(Args &&...args) {
 
   // self repair after restart (shared memory) or wraparound (may not be an
   // issue) - we know that there is no other writer that changes the counter!
-  if (prev % 2 == 0) {
-    // needs to be odd
+  if (prev % 2 != 0) {
+    // a previous write did not finish, needs to be odd
     m_count.fetch_add(1, std::memory_order_acq_rel);
   }
 
@@ -223,5 +226,7 @@ bool sw_atomic_state<T>::has_changed(count_t count) {
 
 template <typename T>
 void sw_atomic_state<T>::reset() {
-  m_count = 0;
+  // even (no write in progress) but still monotonic for has_changed
+  auto count = m_count.load(std::memory_order_relaxed);
+  m_count.store(count + count % 2, std::memory_order_release);
 }
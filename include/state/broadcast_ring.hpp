@@ -0,0 +1,250 @@
+#pragma once
+
+#include "atomic_state.hpp"
+#include "single_wait.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// @brief fixed capacity ring of T with a single writer and up to Readers
+/// independent readers, each reader has its own cursor and sees all messages
+/// pushed after it was attached
+/// @note the writer never waits for readers, a reader that falls more than
+/// Capacity messages behind detects the overrun and skips ahead
+/// @note pointer free and standard layout, i.e. it can be placed in shared
+/// memory and used from several processes
+template <typename T, size_t Capacity, size_t Readers = 16>
+class sw_broadcast_ring {
+private:
+  static constexpr size_t SIZE = sizeof(T);
+  static constexpr size_t ALIGN = alignof(T);
+
+  static_assert(traits::is_memcopyable<T>::value, "T must be memcopyable");
+  static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of 2");
+
+public:
+  using storage_t = typename std::aligned_storage<SIZE, ALIGN>::type;
+  using count_t = uint64_t;
+
+  class reader;
+
+  sw_broadcast_ring() = default;
+
+  sw_broadcast_ring(const sw_broadcast_ring &) = delete;
+  sw_broadcast_ring &operator=(const sw_broadcast_ring &) = delete;
+
+  /// @brief writer only, constructs the next message in place
+  template <typename... Args>
+  void push(Args &&...args);
+
+  /// @brief number of messages pushed so far
+  count_t head() const { return m_head.load(std::memory_order_acquire); }
+
+  /// @brief a reader starting at the current head, not valid if all reader
+  /// slots are in use
+  reader attach();
+
+  static constexpr size_t capacity() { return Capacity; }
+
+  static constexpr size_t max_readers() { return Readers; }
+
+private:
+  // the sequence of a slot is 2p + 1 while message p is written and 2p + 2
+  // when it is complete, i.e. a reader knows which message it has read
+  struct alignas(64) slot {
+    std::atomic<count_t> seq{0};
+    storage_t data;
+  };
+
+  struct alignas(64) reader_slot {
+    std::atomic<bool> attached{false};
+    // the writer notifies readers that park, i.e. are about to block
+    WaitState state;
+  };
+
+  alignas(64) std::atomic<count_t> m_head{0};
+  slot m_slots[Capacity];
+  reader_slot m_readers[Readers];
+
+  static size_t index(count_t position) { return position & (Capacity - 1); }
+
+  static count_t complete(count_t position) { return 2 * position + 2; }
+
+  void notify_readers() {
+    // pairs with the park of a reader before it checks the head again
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto &r : m_readers) {
+      if (r.state.parked() != 0) {
+        Notifier(r.state).notify();
+      }
+    }
+  }
+};
+
+template <typename T, size_t Capacity, size_t Readers>
+class sw_broadcast_ring<T, Capacity, Readers>::reader {
+public:
+  using ring_t = sw_broadcast_ring<T, Capacity, Readers>;
+
+  reader() = default;
+
+  reader(ring_t *ring, size_t id)
+      : m_ring(ring), m_id(id), m_cursor(ring->head()) {}
+
+  reader(const reader &) = delete;
+  reader &operator=(const reader &) = delete;
+
+  reader(reader &&other) { *this = std::move(other); }
+
+  reader &operator=(reader &&other) {
+    detach();
+    m_ring = other.m_ring;
+    m_id = other.m_id;
+    m_cursor = other.m_cursor;
+    m_lost = other.m_lost;
+    other.m_ring = nullptr;
+    return *this;
+  }
+
+  ~reader() { detach(); }
+
+  bool valid() const { return m_ring != nullptr; }
+
+  /// @brief fails if there is no new message
+  bool try_read(storage_t *dest);
+
+  bool try_read(T &dest) {
+    return try_read(reinterpret_cast<storage_t *>(&dest));
+  }
+
+  /// @brief blocks until there is a new message
+  void read(T &dest) {
+    while (!try_read(dest)) {
+      block([](SingleWait &w) { w.wait(); });
+    }
+  }
+
+  /// @brief fails if there is no new message until the deadline
+  bool read_until(T &dest, std::chrono::steady_clock::time_point deadline) {
+    while (!try_read(dest)) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+      block([&](SingleWait &w) { w.wait_until(deadline); });
+    }
+    return true;
+  }
+
+  template <typename Rep, typename Period>
+  bool read_for(T &dest, std::chrono::duration<Rep, Period> timeout) {
+    return read_until(dest, std::chrono::steady_clock::now() + timeout);
+  }
+
+  /// @brief number of messages that are not read yet (including lost ones)
+  count_t available() const { return m_ring->head() - m_cursor; }
+
+  /// @brief messages skipped due to overruns
+  count_t lost() const { return m_lost; }
+
+  /// @brief the next message to read
+  count_t cursor() const { return m_cursor; }
+
+  void detach() {
+    if (m_ring) {
+      m_ring->m_readers[m_id].attached.store(false, std::memory_order_release);
+      m_ring = nullptr;
+    }
+  }
+
+private:
+  ring_t *m_ring{nullptr};
+  size_t m_id{0};
+  count_t m_cursor{0};
+  count_t m_lost{0};
+
+  WaitState &state() { return m_ring->m_readers[m_id].state; }
+
+  template <typename F> void block(F wait) {
+    auto &s = state();
+    SingleWait waitable(s, 0);
+    // announce that we block before checking the head again, then either
+    // the writer sees us or we see the new head
+    s.exchange(WaitState::WAITING);
+    s.park();
+    if (m_ring->head() == m_cursor) {
+      wait(waitable);
+    }
+    s.unpark();
+  }
+};
+
+template <typename T, size_t Capacity, size_t Readers>
+template <typename... Args>
+void sw_broadcast_ring<T, Capacity, Readers>::push(Args &&...args) {
+  auto position = m_head.load(std::memory_order_relaxed);
+  auto &s = m_slots[index(position)];
+
+  s.seq.store(complete(position) - 1, std::memory_order_relaxed);
+  // readers that see the data also see the odd sequence
+  std::atomic_thread_fence(std::memory_order_release);
+
+  new (&s.data) T(std::forward<Args>(args)...);
+
+  s.seq.store(complete(position), std::memory_order_release);
+  m_head.store(position + 1, std::memory_order_release);
+
+  notify_readers();
+}
+
+template <typename T, size_t Capacity, size_t Readers>
+typename sw_broadcast_ring<T, Capacity, Readers>::reader
+sw_broadcast_ring<T, Capacity, Readers>::attach() {
+  for (size_t i = 0; i < Readers; ++i) {
+    bool expected = false;
+    if (m_readers[i].attached.compare_exchange_strong(
+            expected, true, std::memory_order_acq_rel)) {
+      return reader(this, i);
+    }
+  }
+  return reader();
+}
+
+template <typename T, size_t Capacity, size_t Readers>
+bool sw_broadcast_ring<T, Capacity, Readers>::reader::try_read(
+    storage_t *dest) {
+  while (true) {
+    auto &s = m_ring->m_slots[index(m_cursor)];
+    auto seq = s.seq.load(std::memory_order_acquire);
+    auto expected = complete(m_cursor);
+    if (seq < expected) {
+      // not written yet (or in progress)
+      return false;
+    }
+
+    if (seq == expected) {
+      std::memcpy(dest, &s.data, SIZE);
+      // ensure the copy happens before we check the sequence again
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.seq.load(std::memory_order_relaxed) == seq) {
+        ++m_cursor;
+        return true;
+      }
+    }
+
+    // overrun, the writer has already reused the slot,
+    // skip to the oldest message that is not about to be overwritten
+    auto head = m_ring->head();
+    auto oldest = head > Capacity ? head - Capacity + 1 : 0;
+    if (oldest <= m_cursor) {
+      oldest = m_cursor + 1;
+    }
+    m_lost += oldest - m_cursor;
+    m_cursor = oldest;
+  }
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "atomic_state.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+/// @brief single writer atomic state with N buffers (triple buffered by
+/// default)
+/// @note the writer always constructs the new value in the least recently
+/// published buffer, never in the current one, hence a set never invalidates
+/// a load that started after the previous set and a load only fails if N - 1
+/// sets complete during its copy (sw_atomic_state fails on any concurrent set)
+template <typename T, size_t N = 3>
+class sw_buffered_state {
+private:
+  static constexpr size_t SIZE = sizeof(T);
+  static constexpr size_t ALIGN = alignof(T);
+  static constexpr size_t CACHE_LINE = 64;
+
+  static_assert(traits::is_memcopyable<T>::value, "T must be memcopyable");
+  static_assert(N >= 2, "at least two buffers are required");
+
+public:
+  using storage_t = typename std::aligned_storage<SIZE, ALIGN>::type;
+  using count_t = uint64_t;
+
+  template <typename... Args>
+  sw_buffered_state(Args &&...args);
+
+  ~sw_buffered_state();
+
+  sw_buffered_state(const sw_buffered_state &) = delete;
+  sw_buffered_state(sw_buffered_state &&) = delete;
+  sw_buffered_state &operator=(const sw_buffered_state &) = delete;
+  sw_buffered_state &operator=(sw_buffered_state &&) = delete;
+
+  /// @brief set the current value (in-place construction with args)
+  /// @note caller must ensure there are no concurrent writes!
+  template <typename... Args>
+  void set(Args &&...args);
+
+  /// @brief access the current value
+  /// @note caller must ensure there are no concurrent writes!
+  /// @note if there are concurrent loads, any changes to the referenced data
+  /// must be atomic
+  T &get();
+
+  /// @brief try to load the current value and copy into destination,
+  /// @note fails only if the writer reused the buffer during the copy
+  bool try_load(storage_t *dest);
+
+  /// @brief load the current value and copy into destination,
+  /// @note repeats until successful
+  void load(storage_t *dest);
+
+  /// @brief load the current value and return it
+  /// @note may generate an additional copy (depends on NVO)
+  T load();
+
+  /// @brief return the number of published values (sets and updates)
+  /// @note will wrap around, use only for equality comparison or the
+  /// has_changed() function
+  count_t count();
+
+  /// @brief checks whether the counter is equal to the provided counter
+  bool has_changed(count_t count);
+
+  /// @brief resets and unlocks any writers, should only be called
+  /// if there are no concurrent writes in progress (it will not check)
+  /// @note the current value is never written and survives a crashed writer
+  void reset();
+
+  /// @brief call after update by reference
+  void update();
+
+  static constexpr size_t buffers() { return N; }
+
+private:
+  // a buffer is only written while its sequence number is odd
+  struct alignas(CACHE_LINE) buffer {
+    std::atomic<count_t> seq{0};
+    storage_t data;
+  };
+
+  std::array<buffer, N> m_buffers;
+  // only accessed by the writer
+  std::array<bool, N> m_constructed{};
+
+  alignas(CACHE_LINE) std::atomic<size_t> m_current{0};
+  std::atomic<count_t> m_count{0};
+
+  T *ptr(size_t index) { return reinterpret_cast<T *>(&m_buffers[index].data); }
+};
+
+template <typename T, size_t N>
+template <typename... Args>
+sw_buffered_state<T, N>::sw_buffered_state(Args &&...args) {
+  new (ptr(0)) T(std::forward<Args>(args)...);
+  m_constructed[0] = true;
+}
+
+template <typename T, size_t N>
+sw_buffered_state<T, N>::~sw_buffered_state() {
+  for (size_t i = 0; i < N; ++i) {
+    if (m_constructed[i]) {
+      ptr(i)->~T();
+    }
+  }
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+void sw_buffered_state<T, N>::set(Args &&...args) {
+  // the oldest buffer, readers of it are at least N - 1 sets behind
+  auto index = (m_current.load(std::memory_order_relaxed) + 1) % N;
+  auto &b = m_buffers[index];
+
+  auto seq = b.seq.load(std::memory_order_relaxed);
+  // after a crashed write the sequence number is still odd
+  seq += 1 + seq % 2;
+  b.seq.store(seq, std::memory_order_relaxed);
+  // loads of this buffer that read the sequence number before fail
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (m_constructed[index]) {
+    m_constructed[index] = false;
+    ptr(index)->~T();
+  }
+  new (ptr(index)) T(std::forward<Args>(args)...);
+  m_constructed[index] = true;
+
+  b.seq.store(seq + 1, std::memory_order_release);
+  m_current.store(index, std::memory_order_release);
+  m_count.fetch_add(1, std::memory_order_release);
+}
+
+template <typename T, size_t N>
+T &sw_buffered_state<T, N>::get() {
+  return *ptr(m_current.load(std::memory_order_relaxed));
+}
+
+template <typename T, size_t N>
+bool sw_buffered_state<T, N>::try_load(storage_t *dest) {
+  auto index = m_current.load(std::memory_order_acquire);
+  auto &b = m_buffers[index];
+  auto seq = b.seq.load(std::memory_order_acquire);
+  if (seq % 2 != 0) {
+    // the writer already reuses the buffer
+    return false;
+  }
+
+  memcpy(dest, &b.data, SIZE);
+
+  // ensure the copy happens before we check the sequence again
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return seq == b.seq.load(std::memory_order_relaxed);
+}
+
+template <typename T, size_t N>
+void sw_buffered_state<T, N>::load(storage_t *dest) {
+  while (!try_load(dest))
+    ;
+}
+
+template <typename T, size_t N>
+T sw_buffered_state<T, N>::load() {
+  storage_t dest;
+  load(&dest);
+  return *reinterpret_cast<T *>(&dest);
+}
+
+template <typename T, size_t N>
+typename sw_buffered_state<T, N>::count_t sw_buffered_state<T, N>::count() {
+  return m_count.load(std::memory_order_acquire);
+}
+
+template <typename T, size_t N>
+bool sw_buffered_state<T, N>::has_changed(count_t count) {
+  return count != this->count();
+}
+
+template <typename T, size_t N>
+void sw_buffered_state<T, N>::reset() {
+  for (size_t i = 0; i < N; ++i) {
+    auto &b = m_buffers[i];
+    auto seq = b.seq.load(std::memory_order_relaxed);
+    if (seq % 2 != 0) {
+      // the value was not completely constructed
+      m_constructed[i] = false;
+      b.seq.store(seq + 1, std::memory_order_release);
+    }
+  }
+}
+
+template <typename T, size_t N>
+void sw_buffered_state<T, N>::update() {
+  auto &b = m_buffers[m_current.load(std::memory_order_relaxed)];
+  // concurrent loads of the current buffer are invalidated
+  b.seq.fetch_add(2, std::memory_order_release);
+  m_count.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "single_wait.hpp"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#if defined(SYS_futex_waitv) && defined(FUTEX_32)
+#define MULTI_WAIT_HAS_WAITV
+#endif
+
+/// @brief Waits on several WaitStates at once (each behaves like an
+/// AutoResetEvent), returns which sources fired and their signals
+/// @note uses futex_waitv (Linux 5.16+), otherwise all sources are linked to
+/// a summary state which their notifiers also notify, for notifiers in other
+/// processes the summary state must be in the shared memory of the sources
+/// @note the destructor unlinks the sources and waits (bounded by
+/// WaitState::UNLINK_TIMEOUT) for the notifiers still notifying the summary
+/// state
+class MultiWait {
+public:
+  using signal_t = WaitState::value_t;
+
+  // the futex_waitv limit
+  static constexpr size_t MAX_SOURCES = 128;
+
+  struct event {
+    size_t source;
+    signal_t signal;
+  };
+
+  static bool has_futex_waitv() {
+#ifdef MULTI_WAIT_HAS_WAITV
+    static const bool supported = []() {
+      // no waiters is invalid, but we only care whether the call exists
+      auto result = syscall(SYS_futex_waitv, nullptr, 0, 0, nullptr, 0);
+      return !(result < 0 && errno == ENOSYS);
+    }();
+    return supported;
+#else
+    return false;
+#endif
+  }
+
+  /// @brief the summary state is private to this object, i.e. only for
+  /// notifiers in this process
+  MultiWait(bool use_waitv = has_futex_waitv(),
+            uint32_t spin = SingleWait::default_spin())
+      : MultiWait(m_own_summary, use_waitv, spin) {}
+
+  /// @brief the summary state is provided by the caller, e.g. in the same
+  /// shared memory as the sources
+  MultiWait(WaitState &summary, bool use_waitv = has_futex_waitv(),
+            uint32_t spin = SingleWait::default_spin())
+      : m_summary(&summary), m_use_waitv(use_waitv && has_futex_waitv()),
+        m_spin(spin) {
+    m_sources.reserve(MAX_SOURCES);
+  }
+
+  ~MultiWait() {
+    if (!m_use_waitv) {
+      for (auto source : m_sources) {
+        if (!source->unlink()) {
+          std::cerr << "MULTI WAIT ERROR - a notifier did not finish, "
+                       "the summary state may still be used"
+                    << std::endl;
+        }
+      }
+    }
+  }
+
+  MultiWait(const MultiWait &) = delete;
+  MultiWait &operator=(const MultiWait &) = delete;
+
+  /// @brief returns the index of the source, MAX_SOURCES if full
+  /// @note a source must only be waited on by one MultiWait or SingleWait
+  size_t add(WaitState &state) {
+    if (m_sources.size() == MAX_SOURCES) {
+      return MAX_SOURCES;
+    }
+    if (!m_use_waitv) {
+      state.link(m_summary);
+    }
+    m_sources.push_back(&state);
+    return m_sources.size() - 1;
+  }
+
+  size_t size() const { return m_sources.size(); }
+
+  bool uses_waitv() const { return m_use_waitv; }
+
+  /// @brief blocks until at least one source is notified, resets the fired
+  /// sources
+  /// @return the fired sources (valid until the next wait)
+  const std::vector<event> &wait();
+
+  /// @brief returns the fired sources without blocking (may be empty)
+  const std::vector<event> &poll() {
+    m_events.clear();
+    collect();
+    return m_events;
+  }
+
+private:
+  std::vector<WaitState *> m_sources;
+  std::vector<event> m_events;
+  WaitState m_own_summary;
+  WaitState *m_summary;
+  bool m_use_waitv;
+  uint32_t m_spin;
+
+  bool collect() {
+    for (size_t i = 0; i < m_sources.size(); ++i) {
+      auto source = m_sources[i];
+      if (source->value() == WaitState::WAITING) {
+        continue;
+      }
+      auto value = source->exchange(WaitState::WAITING);
+      if (value != WaitState::WAITING) {
+        m_events.push_back({i, value});
+      }
+    }
+    return !m_events.empty();
+  }
+
+  void sleep_all();
+
+  void sleep_summary();
+};
+
+inline const std::vector<MultiWait::event> &MultiWait::wait() {
+  m_events.clear();
+  if (m_sources.empty()) {
+    return m_events;
+  }
+
+  for (uint32_t i = 0; i < m_spin; ++i) {
+    if (collect()) {
+      return m_events;
+    }
+    cpu_relax();
+  }
+
+  while (true) {
+    if (!m_use_waitv) {
+      // reset before collecting, a later notify sets it again
+      m_summary->exchange(WaitState::WAITING);
+    }
+    if (collect()) {
+      return m_events;
+    }
+    if (m_use_waitv) {
+      sleep_all();
+    } else {
+      sleep_summary();
+    }
+  }
+}
+
+inline void MultiWait::sleep_all() {
+#ifdef MULTI_WAIT_HAS_WAITV
+  std::array<futex_waitv, MAX_SOURCES> waiters{};
+  auto n = m_sources.size();
+  for (size_t i = 0; i < n; ++i) {
+    waiters[i].val = WaitState::WAITING;
+    waiters[i].uaddr = reinterpret_cast<uintptr_t>(m_sources[i]->address());
+    // not FUTEX_PRIVATE_FLAG, the states may be in shared memory
+    waiters[i].flags = FUTEX_32;
+    m_sources[i]->park();
+  }
+
+  // returns early (EAGAIN) if any source is not waiting anymore
+  syscall(SYS_futex_waitv, waiters.data(), n, 0, nullptr, CLOCK_MONOTONIC);
+
+  for (size_t i = 0; i < n; ++i) {
+    m_sources[i]->unpark();
+  }
+#endif
+}
+
+inline void MultiWait::sleep_summary() {
+  m_summary->park();
+  syscall(SYS_futex, m_summary->address(), FUTEX_WAIT, WaitState::WAITING, 0,
+          0, 0);
+  m_summary->unpark();
+}
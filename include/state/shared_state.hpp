@@ -0,0 +1,231 @@
+#pragma once
+
+#include "atomic_state.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+/// @brief sw_atomic_state in a POSIX shared memory object, written and read
+/// by different processes
+/// @note writers are serialized by a robust process shared mutex, if a
+/// writer dies during a set (odd count) the next writer or a reader that
+/// fails to load repairs the state with reset() (the current value is kept)
+template <typename T>
+class shared_atomic_state {
+public:
+  using state_t = sw_atomic_state<T>;
+  using storage_t = typename state_t::storage_t;
+  using count_t = typename state_t::count_t;
+
+  /// @brief create the shared memory object and construct the state with
+  /// args, fails if it already exists
+  template <typename... Args>
+  static std::unique_ptr<shared_atomic_state> create(const std::string &name,
+                                                     Args &&...args);
+
+  static constexpr std::chrono::milliseconds OPEN_TIMEOUT{1000};
+
+  /// @brief open a shared memory object created by create,
+  /// waits until the creator has constructed the state, fails if that does
+  /// not happen within timeout (e.g. the creator died)
+  static std::unique_ptr<shared_atomic_state>
+  open(const std::string &name,
+       std::chrono::milliseconds timeout = OPEN_TIMEOUT);
+
+  /// @brief remove the name, mappings of other processes stay valid
+  static bool remove(const std::string &name) {
+    return shm_unlink(name.c_str()) == 0;
+  }
+
+  ~shared_atomic_state() { munmap(m_layout, sizeof(layout)); }
+
+  shared_atomic_state(const shared_atomic_state &) = delete;
+  shared_atomic_state &operator=(const shared_atomic_state &) = delete;
+
+  /// @brief set the current value (in-place construction with args)
+  template <typename... Args>
+  void set(Args &&...args);
+
+  /// @brief fails if there is a concurrent write (or a dead writer)
+  bool try_load(storage_t *dest) { return m_layout->state.try_load(dest); }
+
+  /// @brief repeats until successful, repairs the state of a dead writer
+  void load(storage_t *dest);
+
+  T load() {
+    storage_t dest;
+    load(&dest);
+    return *reinterpret_cast<T *>(&dest);
+  }
+
+  count_t count() { return m_layout->state.count(); }
+
+  bool has_changed(count_t count) { return m_layout->state.has_changed(count); }
+
+  /// @brief repair the state if the last writer died during a set,
+  /// returns whether a repair was necessary
+  bool recover();
+
+private:
+  static constexpr uint64_t MAGIC = 0x73776d7374617465; // "swmstate"
+  // failed loads before a reader checks for a dead writer
+  static constexpr uint32_t RECOVERY_ATTEMPTS = 1024;
+
+  struct layout {
+    std::atomic<uint64_t> initialized;
+    pthread_mutex_t writer;
+    state_t state;
+  };
+
+  layout *m_layout;
+
+  explicit shared_atomic_state(layout *l) : m_layout(l) {}
+
+  static layout *map(int fd) {
+    void *p = mmap(nullptr, sizeof(layout), PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? nullptr : static_cast<layout *>(p);
+  }
+
+  // returns false if the mutex cannot be used anymore
+  bool lock_writer();
+
+  void unlock_writer() { pthread_mutex_unlock(&m_layout->writer); }
+};
+
+template <typename T>
+template <typename... Args>
+std::unique_ptr<shared_atomic_state<T>>
+shared_atomic_state<T>::create(const std::string &name, Args &&...args) {
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (ftruncate(fd, sizeof(layout)) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  auto l = map(fd);
+  if (!l) {
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&l->writer, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  new (&l->state) state_t(std::forward<Args>(args)...);
+  l->initialized.store(MAGIC, std::memory_order_release);
+  return std::unique_ptr<shared_atomic_state>(new shared_atomic_state(l));
+}
+
+template <typename T>
+std::unique_ptr<shared_atomic_state<T>>
+shared_atomic_state<T>::open(const std::string &name,
+                             std::chrono::milliseconds timeout) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    return nullptr;
+  }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  // the creator may not have set the size yet
+  struct stat st;
+  while (fstat(fd, &st) == 0 && size_t(st.st_size) < sizeof(layout) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  if (size_t(st.st_size) < sizeof(layout)) {
+    close(fd);
+    return nullptr;
+  }
+
+  auto l = map(fd);
+  if (!l) {
+    return nullptr;
+  }
+  while (l->initialized.load(std::memory_order_acquire) != MAGIC) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      munmap(l, sizeof(layout));
+      return nullptr;
+    }
+    std::this_thread::yield();
+  }
+  return std::unique_ptr<shared_atomic_state>(new shared_atomic_state(l));
+}
+
+template <typename T>
+bool shared_atomic_state<T>::lock_writer() {
+  auto result = pthread_mutex_lock(&m_layout->writer);
+  if (result == EOWNERDEAD) {
+    // the previous writer died while holding the lock, possibly during a set
+    m_layout->state.reset();
+    pthread_mutex_consistent(&m_layout->writer);
+    return true;
+  }
+  return result == 0;
+}
+
+template <typename T>
+template <typename... Args>
+void shared_atomic_state<T>::set(Args &&...args) {
+  if (!lock_writer()) {
+    std::cerr << "SHARED STATE ERROR - writer lock failed" << std::endl;
+    std::terminate();
+  }
+  m_layout->state.set(std::forward<Args>(args)...);
+  unlock_writer();
+}
+
+template <typename T>
+bool shared_atomic_state<T>::recover() {
+  auto result = pthread_mutex_trylock(&m_layout->writer);
+  if (result == EOWNERDEAD) {
+    m_layout->state.reset();
+    pthread_mutex_consistent(&m_layout->writer);
+    unlock_writer();
+    return true;
+  }
+  if (result == 0) {
+    // no writer, but a write may have been interrupted without the lock
+    // (e.g. a crash in a previous protocol version), an odd count never
+    // becomes even on its own
+    bool odd = m_layout->state.count() % 2 != 0;
+    if (odd) {
+      m_layout->state.reset();
+    }
+    unlock_writer();
+    return odd;
+  }
+  // a writer is alive (EBUSY)
+  return false;
+}
+
+template <typename T>
+void shared_atomic_state<T>::load(storage_t *dest) {
+  uint32_t attempts = 0;
+  while (!try_load(dest)) {
+    if (++attempts % RECOVERY_ATTEMPTS == 0) {
+      recover();
+    }
+  }
+}
@@ -1,11 +1,27 @@
 #pragma once
 
+#include <errno.h>
+
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <linux/futex.h>
 #include <stdint.h>
 #include <sys/syscall.h>
+#include <thread>
+#include <time.h>
 #include <unistd.h>
 
+// hint to the cpu that we are busy waiting (cheaper for the sibling
+// hyperthread and no memory order violation when leaving the loop)
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
 struct WaitState {
   using count_t = uint64_t;
   using value_t = int; // because futex needs it
@@ -27,8 +43,7 @@ struct WaitState {
   value_t value() { return m_value.load(std::memory_order_relaxed); }
 
   value_t exchange(value_t value) {
-    return m_value.exchange(WaitState::WAITING,
-                            std::memory_order::memory_order_acq_rel);
+    return m_value.exchange(value, std::memory_order::memory_order_acq_rel);
   }
 
   bool compare_exchange(value_t &exp, value_t value) {
@@ -42,38 +57,180 @@ struct WaitState {
     return m_count.fetch_add(1, std::memory_order::memory_order_relaxed);
   }
 
+  // number of waiters sleeping in the kernel (or about to),
+  // notifiers only issue a FUTEX_WAKE if this is not 0
+  uint32_t parked() { return m_parked.load(std::memory_order_seq_cst); }
+
+  void park() { m_parked.fetch_add(1, std::memory_order_seq_cst); }
+
+  void unpark() { m_parked.fetch_sub(1, std::memory_order_relaxed); }
+
+  // a MultiWait without futex_waitv sleeps on a summary state that the
+  // notifiers of this state also notify, linked by its offset to this state
+  // (i.e. both must be in the same mapping, which may be at different
+  // addresses in different processes)
+  bool linked() { return m_summary.load(std::memory_order_relaxed) != 0; }
+
+  void link(WaitState *summary) {
+    m_summary.store(reinterpret_cast<char *>(summary) -
+                        reinterpret_cast<char *>(this),
+                    std::memory_order_seq_cst);
+  }
+
+  static constexpr std::chrono::milliseconds UNLINK_TIMEOUT{100};
+
+  // waits for the notifiers that may still use the old link, returns false
+  // if some did not finish in time (e.g. a notifier process died while
+  // notifying, its count is never released)
+  bool unlink(std::chrono::milliseconds timeout = UNLINK_TIMEOUT) {
+    m_summary.store(0, std::memory_order_seq_cst);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (m_linked_notifiers.load(std::memory_order_seq_cst) != 0) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  // the summary is valid until leave_summary (unlink waits for it),
+  // nullptr if not linked
+  WaitState *enter_summary() {
+    m_linked_notifiers.fetch_add(1, std::memory_order_seq_cst);
+    auto offset = m_summary.load(std::memory_order_seq_cst);
+    if (offset == 0) {
+      leave_summary();
+      return nullptr;
+    }
+    return reinterpret_cast<WaitState *>(reinterpret_cast<char *>(this) +
+                                         offset);
+  }
+
+  void leave_summary() {
+    m_linked_notifiers.fetch_sub(1, std::memory_order_release);
+  }
+
 private:
   atomic_t m_value{WAITING};
   std::atomic<count_t> m_count{0};
+  std::atomic<uint32_t> m_parked{0};
+  // 0 if not linked (a state is never its own summary)
+  std::atomic<std::ptrdiff_t> m_summary{0};
+  std::atomic<uint32_t> m_linked_notifiers{0};
 };
 
 /// @brief Behaves like an AutoResetEvent
+/// @note spins up to spin iterations before sleeping in the kernel,
+/// by default not at all on a single core (the notifier cannot run while we
+/// spin)
 class SingleWait {
 public:
   using signal_t = WaitState::value_t;
   using count_t = WaitState::count_t;
 
-  SingleWait(WaitState &state) : m_state(&state) {}
+  static constexpr uint32_t DEFAULT_SPIN = 128;
+
+  static uint32_t default_spin() {
+    static const uint32_t spin =
+        std::thread::hardware_concurrency() > 1 ? DEFAULT_SPIN : 0;
+    return spin;
+  }
+
+  SingleWait(WaitState &state, uint32_t spin = default_spin())
+      : m_state(&state), m_spin(spin) {}
 
   signal_t wait() {
+    auto value = spin_for_signal();
+    if (value != WaitState::WAITING) {
+      return value;
+    }
 
     do {
       auto value = m_state->exchange(WaitState::WAITING);
       if (value != WaitState::WAITING) {
         return value;
       }
+      // the notifier sets the value before it checks for parked waiters,
+      // we announce ourselves before the kernel checks the value,
+      // so either it sees us or the futex does not sleep
+      m_state->park();
       sleep_if_state_equals(WaitState::WAITING);
+      m_state->unpark();
     } while (true);
   }
 
+  /// @brief like wait, but returns WaitState::WAITING if the deadline
+  /// passes without a signal
+  /// @note steady_clock is CLOCK_MONOTONIC (the futex clock) on linux
+  signal_t wait_until(std::chrono::steady_clock::time_point deadline) {
+    auto value = spin_for_signal();
+    if (value != WaitState::WAITING) {
+      return value;
+    }
+
+    auto since_epoch = deadline.time_since_epoch();
+    auto s = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - s);
+    timespec abs_timeout{static_cast<decltype(timespec::tv_sec)>(s.count()),
+                         static_cast<long>(ns.count())};
+
+    do {
+      auto value = m_state->exchange(WaitState::WAITING);
+      if (value != WaitState::WAITING) {
+        return value;
+      }
+      m_state->park();
+      auto result = sleep_until_if_state_equals(WaitState::WAITING,
+                                                abs_timeout);
+      m_state->unpark();
+      if (result < 0 && errno == ETIMEDOUT) {
+        // a notify may have raced with the timeout
+        return m_state->exchange(WaitState::WAITING);
+      }
+    } while (true);
+  }
+
+  template <typename Rep, typename Period>
+  signal_t wait_for(std::chrono::duration<Rep, Period> timeout) {
+    return wait_until(std::chrono::steady_clock::now() + timeout);
+  }
+
   count_t count() { return m_state->count(); }
 
+  uint32_t spin() const { return m_spin; }
+
+  void set_spin(uint32_t spin) { m_spin = spin; }
+
 private:
   WaitState *m_state{nullptr};
+  uint32_t m_spin{0};
+
+  signal_t spin_for_signal() {
+    for (uint32_t i = 0; i < m_spin; ++i) {
+      // only read while spinning, the exchange needs the cache line exclusive
+      if (m_state->value() != WaitState::WAITING) {
+        auto value = m_state->exchange(WaitState::WAITING);
+        if (value != WaitState::WAITING) {
+          return value;
+        }
+      }
+      cpu_relax();
+    }
+    return WaitState::WAITING;
+  }
 
   void sleep_if_state_equals(signal_t value) {
     syscall(SYS_futex, m_state->address(), FUTEX_WAIT, value, 0, 0, 0);
   }
+
+  // FUTEX_WAIT_BITSET takes an absolute timeout (FUTEX_WAIT a relative one),
+  // i.e. no recomputation after spurious wake-ups
+  long sleep_until_if_state_equals(signal_t value, const timespec &deadline) {
+    return syscall(SYS_futex, m_state->address(), FUTEX_WAIT_BITSET, value,
+                   &deadline, 0, FUTEX_BITSET_MATCH_ANY);
+  }
 };
 
 class Notifier {
@@ -95,7 +252,19 @@ public:
 
     m_state->increment();
 
-    wake_one();
+    // pairs with park, nobody sleeps in the kernel if this reads 0
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_state->parked() != 0) {
+      wake_one();
+    }
+
+    if (m_state->linked()) {
+      auto summary = m_state->enter_summary();
+      if (summary) {
+        Notifier(*summary).notify();
+        m_state->leave_summary();
+      }
+    }
   }
 
   bool is_waiting() { return m_state->value() == WaitState::WAITING; }
@@ -12,5 +12,9 @@ using time_t = uint64_t;
 using stime_t = int64_t;
 
 using checkpoint_id_t = uint64_t;
+// dense index of a checkpoint site in the code
+using checkpoint_index_t = uint32_t;
+// node in the per thread tree of nested checkpoints
+using path_index_t = uint32_t;
 
 } // namespace monitor
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "monitoring/api.hpp"
+#include "monitoring/macros.hpp"
+#include "state/single_wait.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// detection latency, the time from a passed deadline until the handler runs
+// (handler time - deadline), for the passive detection (by the monitored
+// thread when it confirms) and the active detection (by the monitoring
+// thread), with the monitoring interval, the number of monitored threads and
+// the background load (spinning threads) varied
+//
+// the monitored threads run with SCHED_OTHER and with SCHED_FIFO (if
+// permitted), the monitoring thread always tries SCHED_FIFO
+//
+// usage: detection_latency [sections per thread] [budget in us]
+
+using namespace std::chrono_literals;
+
+namespace {
+
+enum class detection { passive, active };
+
+struct configuration {
+  detection mode;
+  // of the active monitoring
+  std::chrono::milliseconds interval;
+  uint32_t threads;
+  // spinning threads
+  uint32_t load;
+  // of the monitored threads
+  int policy;
+};
+
+// of the current configuration
+detection g_mode;
+std::mutex g_mutex;
+monitor::latency_histogram g_latency;
+std::atomic<uint64_t> g_missed{0};
+// one per monitored thread, notified by the handler (active detection)
+std::unique_ptr<WaitState[]> g_detected;
+
+thread_local bool tl_monitored{false};
+
+void handler(monitor::checkpoint &check) {
+  auto now = monitor::to_time_unit(monitor::clock_t::now());
+  auto deadline = check.deadline.load(std::memory_order_relaxed);
+
+  // passive detections of missed active ones are not counted
+  auto mode = tl_monitored ? detection::passive : detection::active;
+  if (mode != g_mode) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> g(g_mutex);
+    g_latency.record(now - deadline);
+  }
+  // the checkpoint id is the index of the thread + 1
+  Notifier(g_detected[check.id - 1]).notify();
+}
+
+void set_policy(int policy) {
+  if (policy == SCHED_OTHER) {
+    return;
+  }
+  sched_param params;
+  params.sched_priority = sched_get_priority_min(policy);
+  pthread_setschedparam(pthread_self(), policy, &params);
+}
+
+bool fifo_permitted() {
+  bool permitted = false;
+  std::thread probe([&]() {
+    sched_param params;
+    params.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    permitted =
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &params) == 0;
+  });
+  probe.join();
+  return permitted;
+}
+
+// the deadline passes while the thread sleeps, detected when it confirms
+// (late by the time it takes to wake up)
+void passive_sections(uint32_t id, uint32_t sections,
+                      monitor::time_unit_t budget) {
+  for (uint32_t i = 0; i < sections; ++i) {
+    EXPECT_PROGRESS_IN(budget, id);
+    // the deadline is taken before
+    std::this_thread::sleep_until(monitor::clock_t::now() + budget);
+    CONFIRM_PROGRESS;
+  }
+}
+
+// the thread is stalled until the monitoring thread detects the violation
+void active_sections(uint32_t id, uint32_t sections,
+                     monitor::time_unit_t budget,
+                     std::chrono::milliseconds interval) {
+  auto &detected = g_detected[id - 1];
+  SingleWait waitable(detected);
+  // otherwise the sections start in phase with the monitoring thread (right
+  // after the detection of the previous one)
+  std::mt19937 gen(id);
+  std::uniform_int_distribution<int64_t> offset(
+      0, monitor::time_unit_t(interval).count());
+  for (uint32_t i = 0; i < sections; ++i) {
+    std::this_thread::sleep_for(monitor::time_unit_t(offset(gen)));
+    detected.exchange(WaitState::WAITING);
+    EXPECT_PROGRESS_IN(budget, id);
+    auto timeout = monitor::clock_t::now() + budget + 10 * interval;
+    if (waitable.wait_until(timeout) == WaitState::WAITING) {
+      g_missed.fetch_add(1, std::memory_order_relaxed);
+    }
+    CONFIRM_PROGRESS;
+  }
+}
+
+void run(const configuration &c, uint32_t sections,
+         monitor::time_unit_t budget) {
+  g_mode = c.mode;
+  g_latency.clear();
+  g_missed = 0;
+  g_detected.reset(new WaitState[c.threads]);
+
+  std::atomic<bool> running{true};
+  std::vector<std::thread> stressors;
+  for (uint32_t i = 0; i < c.load; ++i) {
+    stressors.emplace_back([&]() {
+      volatile uint64_t spins = 0;
+      while (running.load(std::memory_order_relaxed)) {
+        spins = spins + 1;
+      }
+    });
+  }
+
+  if (c.mode == detection::active) {
+    START_ACTIVE_MONITORING(c.interval);
+  }
+
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < c.threads; ++i) {
+    threads.emplace_back([&, i]() {
+      set_policy(c.policy);
+      tl_monitored = true;
+      START_THIS_THREAD_MONITORING;
+      if (c.mode == detection::passive) {
+        passive_sections(i + 1, sections, budget);
+      } else {
+        active_sections(i + 1, sections, budget, c.interval);
+      }
+      STOP_THIS_THREAD_MONITORING;
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  if (c.mode == detection::active) {
+    STOP_ACTIVE_MONITORING;
+  }
+  running = false;
+  for (auto &t : stressors) {
+    t.join();
+  }
+}
+
+double us(uint64_t ns) { return double(ns) / 1000; }
+
+void print(const configuration &c) {
+  auto &h = g_latency;
+  std::cout << std::left << std::setw(8)
+            << (c.mode == detection::active ? "active" : "passive")
+            << std::right << std::setw(9)
+            << (c.mode == detection::active
+                    ? std::to_string(c.interval.count()) + "ms"
+                    : "-")
+            << std::setw(8) << c.threads << std::setw(6) << c.load
+            << std::setw(7) << (c.policy == SCHED_FIFO ? "fifo" : "other")
+            << std::setw(9) << h.count() << std::setw(7) << g_missed.load()
+            << std::fixed << std::setprecision(1) << std::setw(10)
+            << us(uint64_t(h.mean())) << std::setw(10)
+            << us(h.value_at_quantile(0.5)) << std::setw(10)
+            << us(h.value_at_quantile(0.9)) << std::setw(10)
+            << us(h.value_at_quantile(0.99)) << std::setw(10)
+            << us(h.value_at_quantile(1)) << std::endl;
+
+  // one bucket per power of 2
+  using histogram = monitor::latency_histogram;
+  for (uint32_t first = 0; first < histogram::NUM_BUCKETS;
+       first += histogram::SUB_BUCKETS) {
+    uint64_t count = 0;
+    for (uint32_t i = first; i < first + histogram::SUB_BUCKETS; ++i) {
+      count += h.bucket(i);
+    }
+    if (count > 0) {
+      auto last = first + histogram::SUB_BUCKETS - 1;
+      std::cout << "    <= " << std::setw(10)
+                << us(histogram::upper_bound(last)) << "us " << std::setw(8)
+                << count << std::endl;
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t sections = 50;
+  auto budget = monitor::time_unit_t(1ms);
+  if (argc > 1 && std::atoi(argv[1]) > 0) {
+    sections = std::atoi(argv[1]);
+  }
+  if (argc > 2 && std::atoi(argv[2]) > 0) {
+    budget = std::chrono::microseconds(std::atoi(argv[2]));
+  }
+
+  monitor::monitor_instance().set_handler(handler);
+
+  std::vector<int> policies{SCHED_OTHER};
+  if (fifo_permitted()) {
+    policies.push_back(SCHED_FIFO);
+  } else {
+    std::cout << "SCHED_FIFO not permitted, running with SCHED_OTHER only"
+              << std::endl;
+  }
+
+  uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<uint32_t> thread_counts{1, 16, 64};
+  std::vector<uint32_t> loads{0, cores, 4 * cores};
+  std::vector<std::chrono::milliseconds> intervals{1ms, 10ms};
+
+  std::cout << "mode     interval threads  load policy  samples missed"
+            << "  mean(us)   p50(us)   p90(us)   p99(us)   max(us)"
+            << std::endl;
+
+  for (auto policy : policies) {
+    for (auto threads : thread_counts) {
+      for (auto load : loads) {
+        configuration c{detection::passive, 0ms, threads, load, policy};
+        run(c, sections, budget);
+        print(c);
+
+        for (auto interval : intervals) {
+          c.mode = detection::active;
+          c.interval = interval;
+          run(c, sections, budget);
+          print(c);
+        }
+      }
+    }
+  }
+
+  return 0;
+}
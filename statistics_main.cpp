@@ -8,6 +8,7 @@
 #include <cmath>
 #include <iostream>
 #include <random>
+#include <string>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -57,7 +58,13 @@ void work2(int iterations) {
   STOP_THIS_THREAD_MONITORING;
 }
 
-int main(void) {
+// with a budget file argument, the budgets are loaded from the file (if it
+// exists) and calibrated budgets are written to it at the end
+int main(int argc, char **argv) {
+  std::string budget_file = argc > 1 ? argv[1] : "";
+  if (!budget_file.empty() && monitor::load_budgets(budget_file)) {
+    std::cout << "budgets loaded from " << budget_file << std::endl;
+  }
 
   std::cout << "normal distribution mean " << MEAN << " stddev " << STDDEV
             << std::endl;
@@ -67,8 +74,6 @@ int main(void) {
 
   START_ACTIVE_MONITORING(100ms);
 
-  // TODO: currently statistics gathering competes for
-  // concurrent shared data access via mutex (change)
   std::thread t1(&work1, 1000);
   std::thread t2(&work1, 1000);
   std::thread t3(&work2, 1000);
@@ -81,5 +86,16 @@ int main(void) {
 
   monitor::print_stats();
 
+  if (!budget_file.empty()) {
+    monitor::calibration_config config;
+    config.percentile = 99.9;
+    config.margin = 1.2;
+    auto n = monitor::calibrate_budgets(config);
+    if (monitor::save_budgets(budget_file)) {
+      std::cout << n << " budgets calibrated and written to " << budget_file
+                << std::endl;
+    }
+  }
+
   return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include "state/broadcast_ring.hpp"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Message {
+  Message() = default;
+
+  Message(uint64_t x) : x(x), y(2 * x) {}
+
+  uint64_t x{0};
+  char space[100];
+  uint64_t y{0};
+};
+
+} // namespace
+
+namespace traits {
+template <> struct is_memcopyable<Message> : public std::true_type {};
+} // namespace traits
+
+namespace {
+
+using Sut = sw_broadcast_ring<Message, 8, 4>;
+
+TEST(BroadcastRingTest, read_in_order) {
+  Sut sut;
+  auto reader = sut.attach();
+  ASSERT_TRUE(reader.valid());
+
+  Message m;
+  EXPECT_FALSE(reader.try_read(m));
+  for (uint64_t i = 0; i < 5; ++i) {
+    sut.push(i);
+  }
+  EXPECT_EQ(reader.available(), 5);
+  for (uint64_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(reader.try_read(m));
+    EXPECT_EQ(m.x, i);
+    EXPECT_EQ(m.y, 2 * i);
+  }
+  EXPECT_FALSE(reader.try_read(m));
+  EXPECT_EQ(reader.lost(), 0);
+}
+
+TEST(BroadcastRingTest, readers_are_independent) {
+  Sut sut;
+  sut.push(1);
+  // only messages after attaching
+  auto first = sut.attach();
+  sut.push(2);
+  auto second = sut.attach();
+  sut.push(3);
+
+  Message m;
+  ASSERT_TRUE(first.try_read(m));
+  EXPECT_EQ(m.x, 2);
+  ASSERT_TRUE(second.try_read(m));
+  EXPECT_EQ(m.x, 3);
+  ASSERT_TRUE(first.try_read(m));
+  EXPECT_EQ(m.x, 3);
+}
+
+TEST(BroadcastRingTest, overrun_skips_ahead) {
+  Sut sut;
+  auto reader = sut.attach();
+  for (uint64_t i = 0; i < 20; ++i) {
+    sut.push(i);
+  }
+
+  // 20 pushed into 8 slots, the oldest slot is the next to be overwritten
+  Message m;
+  ASSERT_TRUE(reader.try_read(m));
+  EXPECT_EQ(m.x, 13);
+  EXPECT_EQ(reader.lost(), 13);
+  uint64_t last = m.x;
+  while (reader.try_read(m)) {
+    EXPECT_EQ(m.x, ++last);
+  }
+  EXPECT_EQ(last, 19);
+}
+
+TEST(BroadcastRingTest, limited_readers) {
+  Sut sut;
+  std::vector<Sut::reader> readers;
+  for (size_t i = 0; i < Sut::max_readers(); ++i) {
+    readers.push_back(sut.attach());
+    EXPECT_TRUE(readers.back().valid());
+  }
+  EXPECT_FALSE(sut.attach().valid());
+
+  readers.back().detach();
+  EXPECT_TRUE(sut.attach().valid());
+}
+
+TEST(BroadcastRingTest, read_for_times_out) {
+  Sut sut;
+  auto reader = sut.attach();
+  Message m;
+  EXPECT_FALSE(reader.read_for(m, std::chrono::milliseconds(10)));
+}
+
+TEST(BroadcastRingTest, blocking_readers) {
+  constexpr uint64_t messages = 10000;
+  constexpr int readers = 3;
+  sw_broadcast_ring<Message, 64, 4> sut;
+  std::atomic<int> attached{0};
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&]() {
+      auto reader = sut.attach();
+      ++attached;
+      Message m;
+      uint64_t expected = 0;
+      while (expected < messages) {
+        reader.read(m);
+        // never older, at most skipped
+        EXPECT_EQ(m.y, 2 * m.x);
+        EXPECT_GE(m.x, expected);
+        expected = m.x + 1;
+      }
+      EXPECT_EQ(reader.cursor(), messages);
+    });
+  }
+
+  while (attached != readers)
+    ;
+  for (uint64_t i = 0; i < messages; ++i) {
+    sut.push(i);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+TEST(BroadcastRingTest, reader_in_other_process) {
+  using Ring = sw_broadcast_ring<Message, 16, 2>;
+  void *p = mmap(nullptr, sizeof(Ring), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(p, MAP_FAILED);
+  auto ring = new (p) Ring();
+  auto reader = ring->attach();
+
+  auto pid = fork();
+  if (pid == 0) {
+    Message m;
+    for (uint64_t i = 0; i < 10; ++i) {
+      if (!reader.read_for(m, std::chrono::seconds(10)) || m.x != i) {
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+
+  for (uint64_t i = 0; i < 10; ++i) {
+    ring->push(i);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  reader.detach();
+  munmap(p, sizeof(Ring));
+}
+
+} // namespace
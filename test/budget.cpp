@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/budget.hpp"
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+using namespace monitor;
+
+checkpoint_index_t first_site() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+checkpoint_index_t second_site() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+stats observed(checkpoint_index_t index, uint64_t n, uint64_t runtime) {
+  stats s;
+  s.location = checkpoint_registry::location(index);
+  for (uint64_t i = 0; i < n; ++i) {
+    s.update(runtime, false);
+  }
+  return s;
+}
+
+TEST(BudgetTableTest, literal_budget_without_override) {
+  budget_table sut;
+  EXPECT_EQ(sut.budget(first_site(), time_unit_t(42)).count(), 42);
+  EXPECT_EQ(sut.budget(UNREGISTERED_CHECKPOINT, time_unit_t(42)).count(), 42);
+}
+
+TEST(BudgetTableTest, override) {
+  budget_table sut;
+  sut.set(first_site(), 7);
+  EXPECT_EQ(sut.budget(first_site(), time_unit_t(42)).count(), 7);
+  EXPECT_EQ(sut.budget(second_site(), time_unit_t(42)).count(), 42);
+
+  sut.clear();
+  EXPECT_EQ(sut.budget(first_site(), time_unit_t(42)).count(), 42);
+}
+
+TEST(BudgetTableTest, write_and_read) {
+  budget_table written;
+  written.set(first_site(), 1000);
+  written.set(second_site(), 2000);
+  std::stringstream file;
+  written.write(file);
+
+  budget_table sut;
+  EXPECT_EQ(sut.read(file), 2);
+  EXPECT_EQ(sut.get(first_site()), 1000);
+  EXPECT_EQ(sut.get(second_site()), 2000);
+}
+
+TEST(BudgetTableTest, unknown_sites_are_ignored) {
+  std::stringstream file("# comment\nunknown.cpp\t12\t1000\tf\ngarbage\n");
+  budget_table sut;
+  EXPECT_EQ(sut.read(file), 0);
+}
+
+TEST(BudgetTableTest, reload_replaces_all_budgets) {
+  budget_table sut;
+  sut.set(first_site(), 1000);
+  sut.set(second_site(), 2000);
+
+  budget_table written;
+  written.set(second_site(), 3000);
+  std::stringstream file;
+  written.write(file);
+
+  sut.reload(file, "budgets.txt");
+  // back to the literal budget
+  EXPECT_EQ(sut.get(first_site()), 0);
+  EXPECT_EQ(sut.get(second_site()), 3000);
+
+  auto status = sut.status();
+  EXPECT_EQ(status.generation, 1);
+  EXPECT_EQ(status.entries, 1);
+  EXPECT_STREQ(status.path, "budgets.txt");
+}
+
+TEST(BudgetTableTest, failed_reload_keeps_budgets) {
+  budget_table sut;
+  sut.set(first_site(), 1000);
+  EXPECT_FALSE(sut.reload("/nonexistent/budgets.txt"));
+  EXPECT_EQ(sut.get(first_site()), 1000);
+  EXPECT_EQ(sut.status().generation, 0);
+}
+
+TEST(CalibrationTest, percentile_times_margin) {
+  calibration_config config;
+  config.margin = 2;
+  config.min_count = 10;
+  config.min_budget = time_unit_t(1);
+
+  stats_table table(checkpoint_registry::count());
+  table[first_site()] = observed(first_site(), 100, 1000);
+  // too few runs
+  table[second_site()] = observed(second_site(), 5, 1000);
+
+  budget_table sut;
+  EXPECT_EQ(calibrate(sut, table, config), 1);
+
+  // within the histogram precision
+  auto b = sut.get(first_site());
+  EXPECT_GE(b, 2000);
+  EXPECT_LE(b, 2000 + 2000 / 16);
+  EXPECT_EQ(sut.get(second_site()), 0);
+}
+
+TEST(CalibrationTest, bounds) {
+  calibration_config config;
+  config.min_count = 1;
+  config.min_budget = time_unit_t(5000);
+  config.max_budget = time_unit_t(50000);
+
+  EXPECT_EQ(derive_budget(observed(first_site(), 10, 10), config), 5000);
+  EXPECT_EQ(derive_budget(observed(first_site(), 10, 1000000), config), 50000);
+}
+
+} // namespace
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include "state/buffered_state.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Bar {
+
+  Bar() = default;
+
+  Bar(int x, int y) : x(x), y(y) {}
+
+  Bar(int x, int y, bool fail) : x(x), y(y) {
+    if (fail) {
+      throw std::runtime_error("construction failed");
+    }
+  }
+
+  int x{73};
+  char space[1024];
+  int y{21};
+};
+
+bool operator==(const Bar &lhs, const Bar &rhs) {
+  return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+} // namespace
+
+namespace traits {
+template <> struct is_memcopyable<Bar> : public std::true_type {};
+} // namespace traits
+
+namespace {
+
+using Sut = sw_buffered_state<Bar>;
+
+class BufferedStateTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+
+  virtual void TearDown() {}
+
+  Sut sut;
+};
+
+TEST_F(BufferedStateTest, default_constructed) {
+  EXPECT_EQ(sut.get(), Bar());
+  EXPECT_EQ(sut.count(), 0);
+  EXPECT_EQ(Sut::buffers(), 3);
+}
+
+TEST_F(BufferedStateTest, non_default_constructed) {
+  Sut s(42, 43);
+  EXPECT_EQ(s.get(), Bar(42, 43));
+  EXPECT_EQ(s.load(), Bar(42, 43));
+}
+
+TEST_F(BufferedStateTest, set_and_load_through_all_buffers) {
+  for (int i = 0; i < 10; ++i) {
+    sut.set(i, 2 * i);
+    EXPECT_EQ(sut.get(), Bar(i, 2 * i));
+    EXPECT_EQ(sut.load(), Bar(i, 2 * i));
+  }
+  EXPECT_EQ(sut.count(), 10);
+}
+
+TEST_F(BufferedStateTest, has_changed_works) {
+  auto prev = sut.count();
+  EXPECT_FALSE(sut.has_changed(prev));
+  sut.set(1, 3);
+  EXPECT_TRUE(sut.has_changed(prev));
+}
+
+TEST_F(BufferedStateTest, update_by_reference) {
+  sut.set(1, 1);
+  auto prev = sut.count();
+  sut.get().y = 2;
+  sut.update();
+  EXPECT_TRUE(sut.has_changed(prev));
+  EXPECT_EQ(sut.load(), Bar(1, 2));
+}
+
+TEST_F(BufferedStateTest, failed_set_keeps_current_value) {
+  sut.set(2, 2);
+  EXPECT_THROW(sut.set(3, 3, true), std::runtime_error);
+
+  // the current buffer was never touched
+  Sut::storage_t dest;
+  EXPECT_TRUE(sut.try_load(&dest));
+  EXPECT_EQ(*reinterpret_cast<Bar *>(&dest), Bar(2, 2));
+
+  sut.reset();
+  sut.set(5, 5);
+  EXPECT_EQ(sut.load(), Bar(5, 5));
+}
+
+TEST_F(BufferedStateTest, set_after_failed_set_without_reset) {
+  EXPECT_THROW(sut.set(3, 3, true), std::runtime_error);
+  sut.set(4, 4);
+  EXPECT_EQ(sut.load(), Bar(4, 4));
+}
+
+TEST(BufferedStateConcurrentTest, single_writer_many_readers) {
+  constexpr int READERS = 4;
+  constexpr int iterations = 100000;
+  sw_buffered_state<Bar, 4> sut(0, 0);
+  std::atomic<int> threads{0};
+  std::atomic<bool> done{false};
+
+  std::thread writer([&]() {
+    ++threads;
+    while (threads != READERS + 1)
+      ;
+    for (int i = 1; i <= iterations; ++i) {
+      sut.set(i, i);
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < READERS; ++r) {
+    readers.emplace_back([&]() {
+      ++threads;
+      while (threads != READERS + 1)
+        ;
+      int last = 0;
+      while (!done) {
+        auto val = sut.load();
+        // atomic and never older than a value loaded before
+        EXPECT_EQ(val.x, val.y);
+        EXPECT_GE(val.x, last);
+        last = val.x;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto &t : readers) {
+    t.join();
+  }
+
+  EXPECT_EQ(sut.load(), Bar(iterations, iterations));
+}
+
+} // namespace
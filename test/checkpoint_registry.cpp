@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/checkpoint_registry.hpp"
+
+#include <cstring>
+#include <set>
+
+namespace {
+
+using namespace monitor;
+
+// never called, but the site is registered anyway
+[[maybe_unused]] checkpoint_index_t never_reached() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+inline checkpoint_index_t reached() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+bool is_registered(const char *function) {
+  for (checkpoint_index_t i = 0; i < checkpoint_registry::count(); ++i) {
+    if (std::strcmp(checkpoint_registry::location(i).function, function) ==
+        0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST(CheckpointRegistryTest, sites_are_registered_before_reached) {
+  EXPECT_TRUE(is_registered("never_reached"));
+  EXPECT_TRUE(is_registered("reached"));
+}
+
+TEST(CheckpointRegistryTest, indices_are_dense_and_unique) {
+  std::set<checkpoint_index_t> indices;
+  indices.insert(reached());
+
+  DEFINE_CHECKPOINT_SITE(site1);
+  DEFINE_CHECKPOINT_SITE(site2);
+  indices.insert(site1::index());
+  indices.insert(site2::index());
+
+  EXPECT_EQ(indices.size(), 3);
+  for (auto index : indices) {
+    EXPECT_LT(index, checkpoint_registry::count());
+  }
+}
+
+TEST(CheckpointRegistryTest, same_site_same_index) {
+  EXPECT_EQ(reached(), reached());
+}
+
+TEST(CheckpointRegistryTest, location) {
+  DEFINE_CHECKPOINT_SITE(site);
+  auto &location = checkpoint_registry::location(site::index());
+  EXPECT_EQ(location.line, __LINE__ - 2);
+  EXPECT_STREQ(location.file, __FILE__);
+  EXPECT_STREQ(location.function, "TestBody");
+  EXPECT_EQ(checkpoint_registry::kind(site::index()),
+            checkpoint_kind::progress);
+}
+
+TEST(CheckpointRegistryTest, wait_site) {
+  DEFINE_WAIT_SITE(site);
+  EXPECT_EQ(checkpoint_registry::kind(site::index()), checkpoint_kind::wait);
+  EXPECT_STREQ(to_string(checkpoint_kind::wait), "wait");
+}
+
+} // namespace
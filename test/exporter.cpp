@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#define MONITORING_STATS
+
+#include "monitoring/exporter.hpp"
+#include "monitoring/macros.hpp"
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+void handler(monitor::checkpoint &) {}
+
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+class ExporterTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    char tmpl[] = "/tmp/monitoring_test_XXXXXX";
+    m_dir = mkdtemp(tmpl);
+
+    START_THIS_THREAD_MONITORING;
+    SET_MONITORING_HANDLER(handler);
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_PROGRESS_IN(100ms, 42);
+      CONFIRM_PROGRESS;
+    }
+  }
+
+  virtual void TearDown() {
+    STOP_THIS_THREAD_MONITORING;
+    std::string cmd = "rm -rf " + m_dir;
+    (void)system(cmd.c_str());
+  }
+
+  std::string m_dir;
+};
+
+TEST_F(ExporterTest, write_openmetrics) {
+  std::ostringstream out;
+  auto table = monitor::monitor_instance().collect_stats();
+  monitor::write_metrics(out, table, monitor::monitor_instance().health());
+  auto text = out.str();
+
+  EXPECT_TRUE(contains(text, "monitor_registered_threads 1\n"));
+  EXPECT_TRUE(contains(text, "# TYPE monitor_checkpoint_runs counter\n"));
+  EXPECT_TRUE(contains(text, "id=\"42\"} "));
+  EXPECT_TRUE(contains(text, "quantile=\"0.999\"}"));
+  EXPECT_TRUE(contains(text, "monitor_detected_violations_total"));
+  EXPECT_EQ(text.substr(text.size() - 6), "# EOF\n");
+}
+
+TEST_F(ExporterTest, labels_are_escaped) {
+  EXPECT_EQ(monitor::metrics::escape("a\"b\\c\nd"), "a\\\"b\\\\c\\nd");
+}
+
+TEST_F(ExporterTest, textfile) {
+  auto path = m_dir + "/monitoring.prom";
+  monitor::stats_exporter exporter(monitor::monitor_instance());
+  ASSERT_TRUE(exporter.start_textfile(path, 10ms));
+
+  std::string text;
+  for (int i = 0; i < 100 && !contains(text, "id=\"42\"} "); ++i) {
+    std::this_thread::sleep_for(10ms);
+    std::ifstream file(path);
+    std::stringstream s;
+    s << file.rdbuf();
+    text = s.str();
+  }
+  exporter.stop();
+
+  EXPECT_TRUE(contains(text, "# TYPE monitor_checkpoint_runs_total counter"));
+  EXPECT_TRUE(contains(text, "monitor_checkpoint_runs_total{"));
+  EXPECT_FALSE(contains(text, "# EOF"));
+}
+
+TEST_F(ExporterTest, update_longer_than_interval) {
+  auto path = m_dir + "/monitoring.prom";
+  monitor::stats_exporter exporter(monitor::monitor_instance());
+  auto &instance = monitor::monitor_instance();
+  {
+    // the update blocks on the monitor
+    std::lock_guard<monitor::thread_monitor> g(instance);
+    ASSERT_TRUE(exporter.start_textfile(path, 1ms));
+    std::this_thread::sleep_for(20ms);
+  }
+  std::this_thread::sleep_for(20ms);
+  // returns within the maximum poll time
+  auto start = std::chrono::steady_clock::now();
+  exporter.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  EXPECT_TRUE(contains(exporter.text(), "monitor_registered_threads"));
+}
+
+TEST_F(ExporterTest, socket) {
+  auto path = m_dir + "/monitoring.sock";
+  monitor::stats_exporter exporter(monitor::monitor_instance());
+  ASSERT_TRUE(exporter.start_socket(path, 10ms));
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+            0);
+
+  std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+  ASSERT_GT(send(fd, request.data(), request.size(), 0), 0);
+
+  std::string response;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, n);
+  }
+  close(fd);
+  exporter.stop();
+
+  EXPECT_TRUE(contains(response, "HTTP/1.0 200 OK"));
+  EXPECT_TRUE(contains(response, "application/openmetrics-text"));
+  EXPECT_TRUE(contains(response, "id=\"42\"} "));
+  EXPECT_TRUE(contains(response, "# EOF\n"));
+}
+
+} // namespace
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/flight_recorder.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace monitor;
+using type = flight_event_type;
+
+checkpoint_index_t site_index() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+flight_event event(type t, uint32_t depth, checkpoint_id_t id = 0) {
+  return {0, id, UNREGISTERED_CHECKPOINT, static_cast<uint16_t>(depth), t};
+}
+
+class FlightRecorderTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    path = "/tmp/flight_recorder_test." + std::to_string(getpid());
+  }
+
+  virtual void TearDown() { unlink(path.c_str()); }
+
+  std::string path;
+};
+
+TEST_F(FlightRecorderTest, records_in_order) {
+  auto recorder = flight_recorder::create(path, 16, 4);
+  ASSERT_TRUE(recorder);
+  auto ring = recorder->claim(7);
+  ASSERT_NE(ring, nullptr);
+  ring->record(type::expect, 100, 1, site_index(), 1);
+  ring->record(type::confirm, 200, 1, site_index(), 1);
+
+  auto reader = flight_recorder::open(path);
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(reader->header().pid, getpid());
+  auto &r = reader->ring(0);
+  EXPECT_EQ(r.os_tid(), 7);
+  auto events = r.events();
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].type, type::expect);
+  EXPECT_EQ(events[0].time, 100);
+  EXPECT_EQ(events[1].type, type::confirm);
+  EXPECT_EQ(events[1].depth, 1);
+
+  auto site = reader->site(events[0].index);
+  ASSERT_NE(site, nullptr);
+  EXPECT_STREQ(site->function, "site_index");
+  EXPECT_EQ(reader->site(UNREGISTERED_CHECKPOINT), nullptr);
+}
+
+TEST_F(FlightRecorderTest, keeps_the_last_events) {
+  auto recorder = flight_recorder::create(path, 4, 1);
+  auto ring = recorder->claim(1);
+  for (uint64_t i = 0; i < 10; ++i) {
+    ring->record(type::expect, i, i, UNREGISTERED_CHECKPOINT, 1);
+  }
+  EXPECT_EQ(recorder->claim(2), nullptr);
+
+  // the slot written next is not reported
+  auto events = ring->events();
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(events[0].id, 7);
+  EXPECT_EQ(events[2].id, 9);
+}
+
+TEST_F(FlightRecorderTest, too_few_events) {
+  EXPECT_FALSE(flight_recorder::create(path, 0, 1));
+  EXPECT_FALSE(flight_recorder::create(path, 1, 1));
+  EXPECT_TRUE(flight_recorder::create(path, 2, 1));
+}
+
+TEST_F(FlightRecorderTest, rejects_corrupted_files) {
+  uint64_t threads_offset;
+  uint64_t size;
+  {
+    auto recorder = flight_recorder::create(path, 16, 4);
+    ASSERT_TRUE(recorder);
+    threads_offset = recorder->header().threads_offset;
+    size = recorder->header().size;
+  }
+  ASSERT_TRUE(flight_recorder::open(path));
+
+  int fd = ::open(path.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+
+  // more rings than the file holds
+  uint32_t max_threads = 1 << 30;
+  auto offset = offsetof(flight_recorder_header, max_threads);
+  uint32_t saved;
+  ASSERT_EQ(pread(fd, &saved, sizeof(saved), offset), sizeof(saved));
+  ASSERT_EQ(pwrite(fd, &max_threads, sizeof(max_threads), offset),
+            sizeof(max_threads));
+  EXPECT_FALSE(flight_recorder::open(path));
+  ASSERT_EQ(pwrite(fd, &saved, sizeof(saved), offset), sizeof(saved));
+  ASSERT_TRUE(flight_recorder::open(path));
+
+  // a zeroed ring (capacity 0)
+  std::vector<char> zeros(sizeof(flight_ring), 0);
+  ASSERT_EQ(pwrite(fd, zeros.data(), zeros.size(), threads_offset),
+            ssize_t(zeros.size()));
+  EXPECT_FALSE(flight_recorder::open(path));
+
+  // truncated
+  ASSERT_EQ(ftruncate(fd, size / 2), 0);
+  EXPECT_FALSE(flight_recorder::open(path));
+  close(fd);
+}
+
+TEST(FlightInProgressTest, nested_checkpoints) {
+  std::vector<flight_event> events{
+      event(type::expect, 1, 1), event(type::expect, 2, 2),
+      event(type::confirm, 2, 2), event(type::expect, 2, 3),
+      event(type::expect, 3, 4), event(type::confirm, 3, 4)};
+  auto active = in_progress(events);
+  ASSERT_EQ(active.size(), 2);
+  EXPECT_EQ(active[0].id, 1);
+  EXPECT_EQ(active[1].id, 3);
+}
+
+TEST(FlightInProgressTest, oldest_events_lost) {
+  // the expect of depth 1 and 2 are overwritten
+  std::vector<flight_event> events{event(type::expect, 3, 3),
+                                   event(type::confirm, 3, 3),
+                                   event(type::confirm, 2, 2)};
+  EXPECT_TRUE(in_progress(events).empty());
+}
+
+TEST_F(FlightRecorderTest, survives_sigkill) {
+  int ready[2];
+  ASSERT_EQ(pipe(ready), 0);
+
+  auto pid = fork();
+  if (pid == 0) {
+    auto recorder = flight_recorder::create(path, 16, 1);
+    auto ring = recorder->claim(this_os_tid());
+    ring->record(type::expect, 1, 10, site_index(), 1);
+    ring->record(type::expect, 2, 11, site_index(), 2);
+    ring->record(type::confirm, 3, 11, site_index(), 2);
+    ring->record(type::expect, 4, 12, site_index(), 2);
+    char c = 1;
+    (void)!write(ready[1], &c, 1);
+    while (true) {
+      pause();
+    }
+  }
+
+  char c;
+  ASSERT_EQ(read(ready[0], &c, 1), 1);
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+  close(ready[0]);
+  close(ready[1]);
+
+  auto recorder = flight_recorder::open(path);
+  ASSERT_TRUE(recorder);
+  EXPECT_EQ(recorder->header().pid, pid);
+  auto active = in_progress(recorder->ring(0).events());
+  ASSERT_EQ(active.size(), 2);
+  EXPECT_EQ(active[0].id, 10);
+  EXPECT_EQ(active[1].id, 12);
+}
+
+} // namespace
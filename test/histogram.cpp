@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/histogram.hpp"
+
+#include <random>
+
+namespace {
+
+using Sut = monitor::log_linear_histogram<4, 40>;
+
+class HistogramTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+
+  virtual void TearDown() {}
+
+  Sut sut;
+};
+
+TEST_F(HistogramTest, empty) {
+  EXPECT_EQ(sut.count(), 0);
+  EXPECT_EQ(sut.value_at_quantile(0.5), 0);
+}
+
+TEST_F(HistogramTest, small_values_are_exact) {
+  for (uint64_t v = 0; v < 2 * Sut::SUB_BUCKETS; ++v) {
+    EXPECT_EQ(Sut::index(v), v);
+    EXPECT_EQ(Sut::lower_bound(v), v);
+    EXPECT_EQ(Sut::upper_bound(v), v);
+  }
+}
+
+TEST_F(HistogramTest, buckets_are_contiguous) {
+  for (uint32_t i = 1; i < Sut::NUM_BUCKETS; ++i) {
+    EXPECT_EQ(Sut::lower_bound(i), Sut::upper_bound(i - 1) + 1);
+    EXPECT_EQ(Sut::index(Sut::lower_bound(i)), i);
+    EXPECT_EQ(Sut::index(Sut::upper_bound(i)), i);
+  }
+  EXPECT_EQ(Sut::upper_bound(Sut::NUM_BUCKETS - 1), Sut::MAX_VALUE);
+}
+
+TEST_F(HistogramTest, relative_error_is_bounded) {
+  std::mt19937_64 gen(42);
+  for (int i = 0; i < 10000; ++i) {
+    auto v = gen() & Sut::MAX_VALUE;
+    auto index = Sut::index(v);
+    auto width = Sut::upper_bound(index) - Sut::lower_bound(index);
+    EXPECT_LE(width, v / Sut::SUB_BUCKETS);
+  }
+}
+
+TEST_F(HistogramTest, large_values_are_clamped) {
+  sut.record(std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(sut.bucket(Sut::NUM_BUCKETS - 1), 1);
+}
+
+TEST_F(HistogramTest, quantiles) {
+  for (uint64_t v = 1; v <= 10000; ++v) {
+    sut.record(v);
+  }
+
+  EXPECT_EQ(sut.count(), 10000);
+  EXPECT_NEAR(sut.value_at_quantile(0.5), 5000, 5000 / Sut::SUB_BUCKETS);
+  EXPECT_NEAR(sut.value_at_quantile(0.99), 9900, 9900 / Sut::SUB_BUCKETS);
+  EXPECT_NEAR(sut.value_at_quantile(0.999), 9990, 9990 / Sut::SUB_BUCKETS);
+  EXPECT_GE(sut.value_at_quantile(1), 10000);
+  EXPECT_NEAR(sut.mean(), 5000, 5000 / Sut::SUB_BUCKETS);
+}
+
+TEST_F(HistogramTest, merge) {
+  Sut other;
+  sut.record(10);
+  other.record(10);
+  other.record(1000);
+
+  sut.merge(other);
+
+  EXPECT_EQ(sut.count(), 3);
+  EXPECT_EQ(sut.bucket(Sut::index(10)), 2);
+  EXPECT_EQ(sut.bucket(Sut::index(1000)), 1);
+}
+
+TEST_F(HistogramTest, clear) {
+  sut.record(10);
+  sut.clear();
+  EXPECT_EQ(sut.count(), 0);
+}
+
+} // namespace
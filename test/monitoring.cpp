@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
 #include "monitoring/macros.hpp"
+#include "monitoring/watchdog.hpp"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <chrono>
 #include <thread>
@@ -97,3 +102,178 @@ TEST_F(MonitoringTest, deadlock_leads_to_violation) {
 
   EXPECT_EQ(g_deadline_violations, 1);
 }
+
+TEST_F(MonitoringTest, monitor_observes_itself) {
+  monitor::monitor_instance().clear_self_stats();
+
+  EXPECT_PROGRESS_IN(10ms, 1);
+  std::this_thread::sleep_for(350ms);
+  EXPECT_DEADLINE_VIOLATION;
+
+  auto stats = monitor::get_monitor_stats();
+  EXPECT_GE(stats.ticks, 2);
+  EXPECT_EQ(stats.scan_duration.count(), stats.ticks);
+  EXPECT_GE(stats.registered_threads.value_at_quantile(1), 1);
+  EXPECT_GE(stats.entries_walked.value_at_quantile(1), 1);
+  EXPECT_EQ(stats.detections, 1);
+  // only detections of the monitoring thread, not the passive ones
+  EXPECT_EQ(stats.detection_lag.count(), 1);
+}
+
+TEST_F(MonitoringTest, violation_record_contains_sched_state) {
+  EXPECT_PROGRESS_IN(10ms, 7);
+  std::this_thread::sleep_for(250ms);
+  EXPECT_DEADLINE_VIOLATION;
+
+  auto violations = monitor::recent_violations();
+  ASSERT_FALSE(violations.empty());
+  auto &v = violations.back();
+  EXPECT_EQ(v.id, 7);
+  EXPECT_EQ(v.os_tid, monitor::this_os_tid());
+  EXPECT_GE(v.delta, 0);
+#ifdef MONITORING_SCHED_STATE
+  // detected while the thread sleeps
+  EXPECT_EQ(v.sched.classification, monitor::sched_class::sleeping);
+#endif
+}
+
+TEST_F(MonitoringTest, enclosing_deadline_due_first) {
+  EXPECT_PROGRESS_IN(20ms, 1);
+  // the nested budget ends after the enclosing one
+  EXPECT_PROGRESS_IN(10s, 2);
+
+  std::this_thread::sleep_for(250ms);
+  // detected by the monitoring thread while the nested checkpoint is active
+  EXPECT_EQ(g_deadline_violations, 1);
+
+  CONFIRM_PROGRESS;
+  EXPECT_DEADLINE_VIOLATION;
+}
+
+TEST_F(MonitoringTest, monitored_wait_over_budget) {
+  WaitState state;
+  SingleWait waitable(state);
+  std::thread notifier([&]() {
+    std::this_thread::sleep_for(250ms);
+    Notifier(state).notify(3);
+  });
+
+  WaitState::value_t signal;
+  MONITORED_WAIT(signal, waitable, 10ms);
+  notifier.join();
+  EXPECT_EQ(signal, 3);
+  EXPECT_EQ(g_deadline_violations, 1);
+
+  auto violations = monitor::recent_violations();
+  ASSERT_FALSE(violations.empty());
+#ifdef MONITORING_SCHED_STATE
+  // detected while blocked in the kernel
+  EXPECT_EQ(violations.back().sched.classification,
+            monitor::sched_class::sleeping);
+#endif
+}
+
+TEST_F(MonitoringTest, monitored_wait_for_timeout) {
+  WaitState state;
+  SingleWait waitable(state);
+
+  WaitState::value_t signal;
+  auto start = monitor::clock_t::now();
+  MONITORED_WAIT_FOR(signal, waitable, 20ms);
+  auto elapsed = monitor::clock_t::now() - start;
+  EXPECT_EQ(signal, WaitState::WAITING);
+
+  // a violation only if the wake-up was delayed beyond the slack
+  auto slack = std::chrono::microseconds(monitor::MONITORED_WAIT_SLACK_US);
+  if (elapsed < 20ms + slack) {
+    EXPECT_EQ(g_deadline_violations, 0);
+  } else {
+    EXPECT_LE(g_deadline_violations, 1);
+  }
+}
+
+TEST_F(MonitoringTest, exported_to_watchdog) {
+  ASSERT_TRUE(monitor::export_to_watchdog());
+  monitor::watchdog watchdog;
+  ASSERT_TRUE(watchdog.watch(monitor::shared_segment::default_name()));
+
+  // only threads registered after the export are mirrored
+  std::atomic<bool> late{false};
+  uint32_t line = 0;
+  std::thread t([&]() {
+    START_THIS_THREAD_MONITORING;
+    line = __LINE__ + 1;
+    EXPECT_PROGRESS_IN(10ms, 5);
+    EXPECT_PROGRESS_IN(10s, 6);
+    late = true;
+    std::this_thread::sleep_for(100ms);
+    CONFIRM_PROGRESS;
+    CONFIRM_PROGRESS;
+    STOP_THIS_THREAD_MONITORING;
+  });
+
+  while (!late)
+    ;
+  std::this_thread::sleep_for(20ms);
+  auto violations = watchdog.check();
+  t.join();
+
+  ASSERT_EQ(violations.size(), 1);
+  EXPECT_EQ(violations[0].pid, getpid());
+  EXPECT_EQ(violations[0].id, 5);
+  EXPECT_EQ(violations[0].line, line);
+  EXPECT_TRUE(watchdog.check().empty());
+}
+
+TEST_F(MonitoringTest, flight_recorded) {
+  auto path = "/tmp/flight_recorded." + std::to_string(getpid());
+  ASSERT_TRUE(monitor::record_flight(path, 16));
+
+  // only threads registered afterwards are recorded
+  std::thread t([&]() {
+    START_THIS_THREAD_MONITORING;
+    EXPECT_PROGRESS_IN(10s, 1);
+    EXPECT_PROGRESS_IN(10s, 2);
+    CONFIRM_PROGRESS;
+    EXPECT_PROGRESS_IN(10s, 3);
+    STOP_THIS_THREAD_MONITORING;
+  });
+  t.join();
+
+  auto recorder = monitor::flight_recorder::open(path);
+  unlink(path.c_str());
+  ASSERT_TRUE(recorder);
+  auto events = recorder->ring(0).events();
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_EQ(events[2].type, monitor::flight_event_type::confirm);
+  EXPECT_EQ(events[2].id, 2);
+  EXPECT_EQ(events[2].depth, 2);
+  EXPECT_LE(events[1].time, events[2].time);
+
+  auto active = monitor::in_progress(events);
+  ASSERT_EQ(active.size(), 2);
+  EXPECT_EQ(active[0].id, 1);
+  EXPECT_EQ(active[1].id, 3);
+}
+
+TEST_F(MonitoringTest, budgets_reload_on_signal) {
+  char path[] = "/tmp/monitoring_budgets_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  auto before = monitor::budgets_status().generation;
+  ASSERT_TRUE(monitor::reload_budgets_on_signal(path));
+  raise(SIGHUP);
+
+  // reloaded by the active monitoring thread
+  for (int i = 0; i < 50 && monitor::budgets_status().generation == before;
+       ++i) {
+    std::this_thread::sleep_for(10ms);
+  }
+  EXPECT_EQ(monitor::budgets_status().generation, before + 1);
+  EXPECT_STREQ(monitor::budgets_status().path, path);
+
+  signal(SIGHUP, SIG_DFL);
+  unlink(path);
+}
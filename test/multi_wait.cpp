@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include "state/multi_wait.hpp"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using event = MultiWait::event;
+
+// with futex_waitv and with the summary state fallback
+class MultiWaitTest : public ::testing::TestWithParam<bool> {
+protected:
+  virtual void SetUp() {
+    if (GetParam() && !MultiWait::has_futex_waitv()) {
+      GTEST_SKIP() << "futex_waitv not supported";
+    }
+  }
+};
+
+TEST_P(MultiWaitTest, uses_requested_mode) {
+  MultiWait sut(GetParam());
+  EXPECT_EQ(sut.uses_waitv(), GetParam());
+}
+
+TEST_P(MultiWaitTest, returns_fired_sources) {
+  std::vector<WaitState> states(3);
+  MultiWait sut(GetParam(), 0);
+  for (auto &s : states) {
+    sut.add(s);
+  }
+  EXPECT_TRUE(sut.poll().empty());
+
+  Notifier(states[0]).notify(4);
+  Notifier(states[2]).notify(1);
+  Notifier(states[2]).notify(2);
+
+  auto &events = sut.wait();
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].source, 0);
+  EXPECT_EQ(events[0].signal, 4);
+  EXPECT_EQ(events[1].source, 2);
+  EXPECT_EQ(events[1].signal, 3);
+
+  // reset
+  EXPECT_TRUE(sut.poll().empty());
+}
+
+TEST_P(MultiWaitTest, blocks_until_notified) {
+  std::vector<WaitState> states(4);
+  MultiWait sut(GetParam(), 0);
+  for (auto &s : states) {
+    sut.add(s);
+  }
+
+  std::thread t([&]() {
+    auto &events = sut.wait();
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].source, 3);
+    EXPECT_EQ(events[0].signal, 73);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  // may happen before or after the wait
+  Notifier(states[3]).notify(73);
+  t.join();
+}
+
+TEST_P(MultiWaitTest, many_producers) {
+  constexpr size_t producers = 16;
+  constexpr int rounds = 100;
+  std::vector<WaitState> states(producers);
+  std::vector<WaitState> acks(producers);
+  MultiWait sut(GetParam(), 0);
+  for (auto &s : states) {
+    sut.add(s);
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < producers; ++i) {
+    threads.emplace_back([&, i]() {
+      Notifier notifier(states[i]);
+      SingleWait ack(acks[i], 0);
+      for (int r = 0; r < rounds; ++r) {
+        notifier.notify(int(i) + 1);
+        ack.wait();
+      }
+    });
+  }
+
+  std::vector<int> received(producers, 0);
+  for (size_t n = 0; n < producers * rounds;) {
+    for (auto &e : sut.wait()) {
+      EXPECT_EQ(e.signal, int(e.source) + 1);
+      ++received[e.source];
+      ++n;
+      Notifier(acks[e.source]).notify();
+    }
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (auto r : received) {
+    EXPECT_EQ(r, rounds);
+  }
+}
+
+TEST_P(MultiWaitTest, notifier_in_other_process) {
+  // the sources and the summary state
+  constexpr size_t size = 4 * sizeof(WaitState);
+  void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(p, MAP_FAILED);
+  auto states = new (p) WaitState[4];
+
+  int status = 0;
+  {
+    MultiWait sut(states[3], GetParam(), 0);
+    for (size_t i = 0; i < 3; ++i) {
+      sut.add(states[i]);
+    }
+
+    auto pid = fork();
+    if (pid == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      Notifier(states[1]).notify(5);
+      _exit(0);
+    }
+
+    auto &events = sut.wait();
+    EXPECT_EQ(events.size(), 1);
+    if (!events.empty()) {
+      EXPECT_EQ(events[0].source, 1);
+      EXPECT_EQ(events[0].signal, 5);
+    }
+    waitpid(pid, &status, 0);
+  }
+  munmap(p, size);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST_P(MultiWaitTest, destroyed_while_notified) {
+  std::vector<WaitState> states(4);
+  std::atomic<bool> running{true};
+  std::vector<std::thread> threads;
+  for (auto &s : states) {
+    threads.emplace_back([&]() {
+      Notifier notifier(s);
+      while (running.load(std::memory_order_relaxed)) {
+        notifier.notify();
+      }
+    });
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    MultiWait sut(GetParam(), 0);
+    for (auto &s : states) {
+      sut.add(s);
+    }
+    EXPECT_FALSE(sut.wait().empty());
+  }
+  for (auto &s : states) {
+    EXPECT_FALSE(s.linked());
+  }
+
+  running = false;
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, MultiWaitTest, ::testing::Values(true, false));
+
+TEST(MultiWaitUnlinkTest, notifier_died_while_notifying) {
+  WaitState source;
+  WaitState summary;
+  source.link(&summary);
+  // entered but never left, like a notifier process that was killed
+  ASSERT_EQ(source.enter_summary(), &summary);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(source.unlink(std::chrono::milliseconds(10)));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  EXPECT_FALSE(source.linked());
+
+  source.leave_summary();
+  EXPECT_TRUE(source.unlink());
+}
+
+TEST(MultiWaitLimitTest, at_most_max_sources) {
+  std::vector<WaitState> states(MultiWait::MAX_SOURCES + 1);
+  MultiWait sut;
+  for (size_t i = 0; i < MultiWait::MAX_SOURCES; ++i) {
+    EXPECT_EQ(sut.add(states[i]), i);
+  }
+  EXPECT_EQ(sut.add(states.back()), MultiWait::MAX_SOURCES);
+  EXPECT_EQ(sut.size(), MultiWait::MAX_SOURCES);
+}
+
+} // namespace
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/path_stats.hpp"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+
+using namespace monitor;
+
+checkpoint_index_t outer_site() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+checkpoint_index_t inner_site() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+class LocalPathsTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+
+  virtual void TearDown() {}
+
+  // the root, the overflow node and 3 paths
+  std::unique_ptr<local_paths> sut{std::make_unique<local_paths>(5)};
+};
+
+TEST_F(LocalPathsTest, paths_are_interned) {
+  auto outer = sut->child(ROOT_PATH, outer_site());
+  auto inner = sut->child(outer, inner_site());
+  EXPECT_NE(outer, ROOT_PATH);
+  EXPECT_NE(inner, outer);
+  EXPECT_EQ(sut->child(ROOT_PATH, outer_site()), outer);
+  EXPECT_EQ(sut->child(outer, inner_site()), inner);
+  // same site, different parent
+  EXPECT_NE(sut->child(ROOT_PATH, inner_site()), inner);
+  EXPECT_EQ(sut->size(), 5);
+}
+
+TEST_F(LocalPathsTest, full_tree_collects_in_overflow) {
+  auto outer = sut->child(ROOT_PATH, outer_site());
+  auto inner = sut->child(outer, inner_site());
+  auto innermost = sut->child(inner, inner_site());
+  auto overflow = sut->child(innermost, outer_site());
+  EXPECT_EQ(overflow, OVERFLOW_PATH);
+  // the checkpoints nested in it as well, not new top level paths
+  EXPECT_EQ(sut->child(overflow, inner_site()), OVERFLOW_PATH);
+  EXPECT_EQ(sut->child(ROOT_PATH, inner_site()), OVERFLOW_PATH);
+
+  sut->update(overflow, 20, 10);
+  sut->update(sut->child(overflow, inner_site()), 10, 10);
+  sut->update(outer, 100, 100);
+
+  path_profile profile;
+  sut->merge_into(profile);
+  ASSERT_EQ(profile.size(), 2);
+  auto &other = profile[checkpoint_path{}];
+  EXPECT_EQ(other.count, 2);
+  EXPECT_EQ(other.self, 20);
+  EXPECT_EQ(profile[{outer_site()}].self, 100);
+}
+
+TEST_F(LocalPathsTest, merge_by_path) {
+  auto outer = sut->child(ROOT_PATH, outer_site());
+  auto inner = sut->child(outer, inner_site());
+  sut->update(inner, 30, 30);
+  sut->update(outer, 100, 70);
+
+  local_paths other(4);
+  // created in a different order, hence different node indices
+  auto other_inner = other.child(other.child(ROOT_PATH, outer_site()),
+                                 inner_site());
+  other.update(other_inner, 10, 10);
+
+  path_profile profile;
+  sut->merge_into(profile);
+  other.merge_into(profile);
+  ASSERT_EQ(profile.size(), 2);
+
+  auto &o = profile[{outer_site()}];
+  EXPECT_EQ(o.count, 1);
+  EXPECT_EQ(o.inclusive, 100);
+  EXPECT_EQ(o.self, 70);
+
+  auto &i = profile[{outer_site(), inner_site()}];
+  EXPECT_EQ(i.count, 2);
+  EXPECT_EQ(i.self, 40);
+}
+
+TEST_F(LocalPathsTest, clear) {
+  sut->update(sut->child(ROOT_PATH, outer_site()), 1, 1);
+  sut->clear();
+  EXPECT_EQ(sut->size(), 2);
+
+  path_profile profile;
+  sut->merge_into(profile);
+  EXPECT_TRUE(profile.empty());
+}
+
+TEST(FoldedStacksTest, self_time_per_path) {
+  path_profile profile;
+  profile[{outer_site()}] = path_time{1, 100, 70};
+  profile[{outer_site(), inner_site()}] = path_time{1, 30, 30};
+  profile[{UNREGISTERED_CHECKPOINT}] = path_time{1, 5, 0};
+
+  std::ostringstream out;
+  write_folded(out, profile);
+  auto text = out.str();
+
+  EXPECT_NE(text.find("outer_site ("), std::string::npos);
+  EXPECT_NE(text.find(" 70\n"), std::string::npos);
+  EXPECT_NE(text.find(");inner_site ("), std::string::npos);
+  EXPECT_NE(text.find(" 30\n"), std::string::npos);
+  // no self time
+  EXPECT_EQ(text.find("unregistered"), std::string::npos);
+}
+
+} // namespace
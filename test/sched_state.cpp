@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/sched_state.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using namespace monitor;
+
+TEST(SchedStateTest, calling_thread_is_running) {
+  auto s = read_sched_state(this_os_tid());
+  EXPECT_EQ(s.state, 'R');
+  EXPECT_EQ(s.classification, sched_class::running);
+  EXPECT_GT(s.run_time, 0);
+}
+
+TEST(SchedStateTest, waiting_thread_is_sleeping) {
+  std::mutex mutex;
+  std::condition_variable condvar;
+  bool done = false;
+  std::atomic<os_tid_t> tid{0};
+
+  std::thread waiter([&]() {
+    tid = this_os_tid();
+    std::unique_lock<std::mutex> lock(mutex);
+    condvar.wait(lock, [&]() { return done; });
+  });
+
+  while (tid == 0) {
+    std::this_thread::yield();
+  }
+  // give the thread time to block
+  sched_state s;
+  for (int i = 0; i < 100 && s.classification != sched_class::sleeping; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    s = read_sched_state(tid);
+  }
+  EXPECT_EQ(s.classification, sched_class::sleeping);
+  EXPECT_EQ(s.state, 'S');
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  condvar.notify_one();
+  waiter.join();
+}
+
+TEST(SchedStateTest, unknown_thread) {
+  auto s = read_sched_state(0);
+  EXPECT_EQ(s.classification, sched_class::unknown);
+  EXPECT_EQ(s.state, 0);
+}
+
+} // namespace
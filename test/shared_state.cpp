@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "state/shared_state.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+struct Baz {
+
+  Baz() = default;
+
+  Baz(int x, int y) : x(x), y(y) {}
+
+  // the writer process dies in the middle of the set (odd count)
+  Baz(int x, int y, bool die) : x(x), y(y) {
+    if (die) {
+      kill(getpid(), SIGKILL);
+    }
+  }
+
+  int x{73};
+  char space[256];
+  int y{21};
+};
+
+bool operator==(const Baz &lhs, const Baz &rhs) {
+  return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+} // namespace
+
+namespace traits {
+template <> struct is_memcopyable<Baz> : public std::true_type {};
+} // namespace traits
+
+namespace {
+
+using Sut = shared_atomic_state<Baz>;
+
+class SharedStateTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    name = "/shared_state_test_" + std::to_string(getpid());
+    Sut::remove(name);
+    sut = Sut::create(name, 1, 2);
+    ASSERT_TRUE(sut);
+  }
+
+  virtual void TearDown() { Sut::remove(name); }
+
+  // runs f in a child process, returns its wait status
+  template <typename F> int in_child(F f) {
+    auto pid = fork();
+    if (pid == 0) {
+      _exit(f());
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return status;
+  }
+
+  std::string name;
+  std::unique_ptr<Sut> sut;
+};
+
+TEST_F(SharedStateTest, create_fails_if_exists) {
+  EXPECT_FALSE(Sut::create(name));
+}
+
+TEST_F(SharedStateTest, open_fails_if_missing) {
+  EXPECT_FALSE(Sut::open(name + "_missing"));
+}
+
+TEST_F(SharedStateTest, open_fails_if_creator_died) {
+  auto died = name + "_died";
+  // before the size is set
+  int fd = shm_open(died.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  ASSERT_GE(fd, 0);
+  EXPECT_FALSE(Sut::open(died, std::chrono::milliseconds(10)));
+
+  // before the state is constructed
+  // large enough for the layout
+  ASSERT_EQ(ftruncate(fd, 1 << 20), 0);
+  close(fd);
+  EXPECT_FALSE(Sut::open(died, std::chrono::milliseconds(10)));
+  Sut::remove(died);
+}
+
+TEST_F(SharedStateTest, set_and_load_across_mappings) {
+  auto other = Sut::open(name);
+  ASSERT_TRUE(other);
+  EXPECT_EQ(other->load(), Baz(1, 2));
+
+  other->set(3, 4);
+  EXPECT_EQ(sut->load(), Baz(3, 4));
+  EXPECT_EQ(sut->count(), 2);
+}
+
+TEST_F(SharedStateTest, set_in_other_process) {
+  auto status = in_child([&]() {
+    auto other = Sut::open(name);
+    if (!other) {
+      return 1;
+    }
+    other->set(5, 6);
+    return 0;
+  });
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(sut->load(), Baz(5, 6));
+}
+
+TEST_F(SharedStateTest, reader_recovers_from_dead_writer) {
+  auto status = in_child([&]() {
+    Sut::open(name)->set(7, 8, true);
+    return 0;
+  });
+  ASSERT_TRUE(WIFSIGNALED(status));
+
+  // the writer died during the set
+  Sut::storage_t dest;
+  EXPECT_EQ(sut->count() % 2, 1);
+  EXPECT_FALSE(sut->try_load(&dest));
+
+  // load detects the dead writer and keeps the last complete value
+  EXPECT_EQ(sut->load(), Baz(1, 2));
+  EXPECT_EQ(sut->count() % 2, 0);
+  EXPECT_FALSE(sut->recover());
+
+  sut->set(9, 10);
+  EXPECT_EQ(sut->load(), Baz(9, 10));
+}
+
+TEST_F(SharedStateTest, writer_recovers_from_dead_writer) {
+  sut->set(3, 3);
+  auto status = in_child([&]() {
+    Sut::open(name)->set(7, 8, true);
+    return 0;
+  });
+  ASSERT_TRUE(WIFSIGNALED(status));
+
+  sut->set(4, 4);
+  EXPECT_EQ(sut->count() % 2, 0);
+  EXPECT_EQ(sut->load(), Baz(4, 4));
+}
+
+} // namespace
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/slo.hpp"
+
+#include <vector>
+
+namespace {
+
+using namespace monitor;
+
+totals_table cumulative(uint64_t count, uint64_t violations) {
+  // site 0 has checkpoint id 12, site 1 id 13
+  totals_table table(2);
+  table[0] = totals{12, count, violations, count};
+  table[1] = totals{13, 2 * count, 0, 0};
+  return table;
+}
+
+class SlidingWindowTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+
+  virtual void TearDown() {}
+
+  sliding_window sut{4};
+};
+
+TEST_F(SlidingWindowTest, first_rotation_sets_baseline) {
+  sut.rotate(cumulative(100, 1));
+  EXPECT_EQ(sut.filled(), 0);
+  EXPECT_EQ(sut.aggregate(12, 4).count, 0);
+}
+
+TEST_F(SlidingWindowTest, buckets_contain_differences) {
+  sut.rotate(cumulative(100, 1));
+  sut.rotate(cumulative(110, 1));
+  sut.rotate(cumulative(130, 3));
+
+  EXPECT_EQ(sut.aggregate(12, 1).count, 20);
+  EXPECT_EQ(sut.aggregate(12, 1).violations, 2);
+  EXPECT_EQ(sut.aggregate(12, 2).count, 30);
+  EXPECT_EQ(sut.aggregate(13, 2).count, 60);
+  EXPECT_EQ(sut.aggregate_site(0, 2).count, 30);
+}
+
+TEST_F(SlidingWindowTest, old_buckets_are_dropped) {
+  sut.rotate(cumulative(0, 0));
+  for (uint64_t i = 1; i <= 10; ++i) {
+    sut.rotate(cumulative(i * 10, 0));
+  }
+
+  EXPECT_EQ(sut.filled(), 4);
+  EXPECT_EQ(sut.aggregate(12, 100).count, 40);
+}
+
+TEST_F(SlidingWindowTest, new_sites) {
+  sut.rotate(totals_table(1));
+  sut.rotate(cumulative(10, 0));
+  EXPECT_EQ(sut.aggregate(13, 1).count, 20);
+}
+
+TEST(BurnRateTest, burn_rate) {
+  // 1% errors with a 99% objective - budget is used up exactly
+  EXPECT_NEAR(burn_rate(totals{1, 100, 1, 0}, 0.99), 1, 1e-9);
+  EXPECT_NEAR(burn_rate(totals{1, 100, 10, 0}, 0.99), 10, 1e-9);
+  EXPECT_DOUBLE_EQ(burn_rate(totals{1, 0, 0, 0}, 0.99), 0);
+}
+
+class SloMonitorTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    slo objective;
+    objective.id = 12;
+    objective.objective = 0.99;
+    objective.long_window = 8;
+    objective.short_window = 2;
+    objective.burn_rate_threshold = 10;
+    sut.add(objective);
+    sut.set_handler(
+        [this](slo_status &status) { alarms.push_back(status); });
+  }
+
+  virtual void TearDown() {}
+
+  slo_monitor sut{8};
+  std::vector<slo_status> alarms;
+};
+
+TEST_F(SloMonitorTest, no_alarm_within_budget) {
+  for (uint64_t i = 0; i < 10; ++i) {
+    sut.rotate(cumulative(i * 100, 0));
+  }
+  EXPECT_TRUE(alarms.empty());
+  EXPECT_FALSE(sut.status().at(0).alarm);
+}
+
+TEST_F(SloMonitorTest, alarm_once_when_burning) {
+  sut.rotate(cumulative(0, 0));
+  // 20% violations, burn rate 20
+  for (uint64_t i = 1; i < 5; ++i) {
+    sut.rotate(cumulative(i * 100, i * 20));
+  }
+
+  ASSERT_EQ(alarms.size(), 1);
+  EXPECT_EQ(alarms[0].objective.id, 12);
+  EXPECT_NEAR(alarms[0].short_burn_rate, 20, 1e-9);
+  EXPECT_TRUE(sut.status().at(0).alarm);
+}
+
+TEST_F(SloMonitorTest, alarm_stops_with_short_window) {
+  sut.rotate(cumulative(0, 0));
+  sut.rotate(cumulative(100, 20));
+  ASSERT_EQ(alarms.size(), 1);
+
+  // no violations anymore
+  sut.rotate(cumulative(200, 20));
+  sut.rotate(cumulative(300, 20));
+  EXPECT_FALSE(sut.status().at(0).alarm);
+  EXPECT_EQ(sut.window_totals(12, 8).violations, 20);
+}
+
+} // namespace
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/snapshot.hpp"
+
+#include <atomic>
+#include <limits>
+#include <thread>
+
+namespace {
+
+using namespace monitor;
+
+TEST(PublishedSnapshotTest, initially_empty) {
+  published_snapshot sut;
+  deadline_snapshot s;
+  ASSERT_TRUE(sut.try_load(s));
+  EXPECT_EQ(s.depth, 0);
+}
+
+TEST(PublishedSnapshotTest, publish_and_load) {
+  published_snapshot sut;
+  sut.publish({100, 7, 50, 2});
+
+  deadline_snapshot s;
+  ASSERT_TRUE(sut.try_load(s));
+  EXPECT_EQ(s.deadline, 100);
+  EXPECT_EQ(s.id, 7);
+  EXPECT_EQ(s.min_deadline, 50);
+  EXPECT_EQ(s.depth, 2);
+
+  sut.clear();
+  ASSERT_TRUE(sut.try_load(s));
+  EXPECT_EQ(s.depth, 0);
+}
+
+TEST(PublishedSnapshotTest, snapshots_are_consistent) {
+  published_snapshot sut;
+  std::atomic<bool> done{false};
+
+  // all fields of a snapshot are derived from the same value
+  std::thread writer([&]() {
+    for (uint32_t i = 1; i <= 200000; ++i) {
+      sut.publish({i, i, i, i});
+    }
+    done = true;
+  });
+
+  while (!done) {
+    deadline_snapshot s;
+    if (sut.try_load(s)) {
+      EXPECT_EQ(s.deadline, s.depth);
+      EXPECT_EQ(s.id, s.depth);
+      EXPECT_EQ(s.min_deadline, s.depth);
+    }
+  }
+  writer.join();
+}
+
+TEST(TimeTest, is_earlier_with_wraparound) {
+  EXPECT_TRUE(is_earlier(1, 2));
+  EXPECT_FALSE(is_earlier(2, 1));
+  EXPECT_FALSE(is_earlier(2, 2));
+  EXPECT_TRUE(is_earlier(std::numeric_limits<monitor::time_t>::max(), 1));
+}
+
+TEST(PublishedMinDeadlineTest, publish_and_load) {
+  published_min_deadline sut;
+  EXPECT_EQ(sut.load(), published_min_deadline::NONE);
+
+  sut.publish(50);
+  EXPECT_EQ(sut.load(), 50);
+
+  sut.clear();
+  EXPECT_EQ(sut.load(), published_min_deadline::NONE);
+}
+
+} // namespace
@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/statistics.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using namespace monitor;
+
+constexpr uint32_t SIZE = 16;
+
+class LocalStatsTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+
+  virtual void TearDown() {}
+
+  // large, avoid the stack
+  std::unique_ptr<local_stats> sut{std::make_unique<local_stats>(SIZE)};
+};
+
+TEST_F(LocalStatsTest, preallocated) {
+  stats_table result;
+  sut->merge_into(result);
+  ASSERT_EQ(result.size(), SIZE);
+  for (auto &s : result) {
+    EXPECT_EQ(s.count, 0);
+  }
+}
+
+TEST_F(LocalStatsTest, update_single_checkpoint) {
+  sut->update(1, 73, 10, false);
+  sut->update(1, 73, 30, true);
+
+  stats_table result;
+  sut->merge_into(result);
+
+  auto &s = result.at(1);
+  EXPECT_EQ(s.id, 73);
+  EXPECT_EQ(s.count, 2);
+  EXPECT_EQ(s.violations, 1);
+  EXPECT_EQ(s.min, 10);
+  EXPECT_EQ(s.max, 30);
+  EXPECT_DOUBLE_EQ(s.mean(), 20);
+  EXPECT_EQ(result.at(0).count, 0);
+}
+
+TEST_F(LocalStatsTest, update_multiple_checkpoints) {
+  for (checkpoint_index_t index = 0; index < 10; ++index) {
+    sut->update(index, index, index, false);
+  }
+
+  stats_table result;
+  sut->merge_into(result);
+  EXPECT_EQ(result.at(7).max, 7);
+  EXPECT_EQ(result.at(7).count, 1);
+}
+
+TEST_F(LocalStatsTest, unregistered_checkpoints_are_gathered_together) {
+  sut->update(UNREGISTERED_CHECKPOINT, 1, 10, false);
+  sut->update(UNREGISTERED_CHECKPOINT, 2, 10, false);
+
+  stats_table result;
+  sut->merge_into(result);
+  EXPECT_EQ(result.at(SIZE - 1).count, 2);
+}
+
+TEST_F(LocalStatsTest, merge_accumulates) {
+  auto other = std::make_unique<local_stats>(SIZE);
+  sut->update(1, 1, 10, false);
+  other->update(1, 1, 20, true);
+  other->update(1, 1, 30, false);
+
+  stats_table result;
+  sut->merge_into(result);
+  other->merge_into(result);
+
+  auto &s = result.at(1);
+  EXPECT_EQ(s.count, 3);
+  EXPECT_EQ(s.violations, 1);
+  EXPECT_EQ(s.min, 10);
+  EXPECT_EQ(s.max, 30);
+  EXPECT_DOUBLE_EQ(s.mean(), 20);
+}
+
+TEST_F(LocalStatsTest, percentiles) {
+  for (monitor::time_t t = 1; t <= 1000; ++t) {
+    sut->update(1, 1, t, t > 990);
+  }
+
+  stats_table result;
+  sut->merge_into(result);
+  auto &s = result.at(1);
+
+  // within the histogram resolution
+  EXPECT_NEAR(s.percentile(50), 500, 500 / 16);
+  EXPECT_NEAR(s.percentile(99), 990, 990 / 16);
+  EXPECT_EQ(s.percentile(100), 1000);
+  EXPECT_DOUBLE_EQ(s.violation_ratio(), 0.01);
+}
+
+TEST_F(LocalStatsTest, clear) {
+  sut->update(1, 1, 10, false);
+  sut->clear();
+
+  stats_table result;
+  sut->merge_into(result);
+  EXPECT_EQ(result.at(1).count, 0);
+}
+
+TEST(LocalStatsConcurrentTest, snapshots_are_consistent) {
+  constexpr uint64_t iterations = 100000;
+  auto sut = std::make_unique<local_stats>(SIZE);
+  std::atomic<bool> done{false};
+
+  // runtime is always 1, hence min and max must match in any snapshot
+  std::thread writer([&]() {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      sut->update(1, 1, 1, false);
+    }
+    done = true;
+  });
+
+  uint64_t last = 0;
+  while (!done) {
+    stats_table result;
+    sut->merge_into(result);
+    auto &s = result.at(1);
+    EXPECT_GE(s.count, last);
+    if (s.count > 0) {
+      EXPECT_EQ(s.min, 1);
+      EXPECT_EQ(s.max, 1);
+      EXPECT_EQ(s.sum, s.count);
+    }
+    last = s.count;
+  }
+
+  writer.join();
+
+  stats_table result;
+  sut->merge_into(result);
+  EXPECT_EQ(result.at(1).count, iterations);
+}
+
+TEST_F(LocalStatsTest, cpu_attribution) {
+  cpu_sample used;
+  used.cpu_time = 20;
+  used.voluntary_switches = 1;
+  used.involuntary_switches = 3;
+  sut->update(1, 1, 100, true, used);
+  sut->update(1, 1, 30, false, used);
+
+  stats_table result;
+  sut->merge_into(result);
+  auto &s = result.at(1);
+  EXPECT_EQ(s.count, 2);
+  EXPECT_EQ(s.over_budget.count, 1);
+  EXPECT_EQ(s.over_budget.off_cpu_time(), 80);
+  EXPECT_EQ(s.over_budget.involuntary_switches, 3);
+  EXPECT_EQ(s.within_budget.count, 1);
+  EXPECT_EQ(s.within_budget.off_cpu_time(), 10);
+}
+
+TEST(CpuSampleTest, busy_thread_uses_cpu_time) {
+  auto start = thread_cpu_sample();
+  auto wall_start = monitor::clock_t::now();
+  volatile uint64_t x = 0;
+  while (monitor::clock_t::now() - wall_start < std::chrono::milliseconds(20)) {
+    x = x + 1;
+  }
+  auto used = thread_cpu_sample() - start;
+  EXPECT_GT(used.cpu_time, 0);
+}
+
+TEST_F(LocalStatsTest, perf_attribution) {
+  perf_sample used;
+  used.values[0] = 1000;
+  used.values[1] = 4;
+  sut->update(1, 42, 10, false, &used);
+  used.values[0] = 3000;
+  sut->update(1, 42, 20, true, &used);
+  // counters not available
+  sut->update(1, 42, 30, false, nullptr);
+
+  stats_table result;
+  sut->merge_into(result);
+  auto &s = result.at(1);
+  EXPECT_EQ(s.count, 3);
+  EXPECT_EQ(s.violations, 1);
+  EXPECT_EQ(s.perf.count, 2);
+  EXPECT_EQ(s.perf.instructions, 4000);
+  EXPECT_EQ(s.perf.cache_misses, 8);
+}
+
+// software events are available without a PMU (e.g. in VMs)
+const std::vector<perf_event_spec> software_events{
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task_clock"},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "page_faults"}};
+
+TEST(PerfCountersTest, group_counts_busy_thread) {
+  perf_counters counters(software_events);
+  if (!counters.valid()) {
+    GTEST_SKIP() << "perf_event_open not permitted";
+  }
+  counters.start();
+  auto wall_start = monitor::clock_t::now();
+  volatile uint64_t x = 0;
+  while (monitor::clock_t::now() - wall_start < std::chrono::milliseconds(20)) {
+    x = x + 1;
+  }
+  counters.stop();
+  auto sample = counters.read();
+  EXPECT_TRUE(counters.available(0));
+  // task clock in ns
+  EXPECT_GT(sample.values[0], 1000000);
+}
+
+TEST(PerfCountersTest, unavailable_events_are_skipped) {
+  perf_counters counters({{PERF_TYPE_MAX + 1, 0, "invalid"},
+                          software_events[0]});
+  EXPECT_EQ(counters.size(), 2);
+  EXPECT_FALSE(counters.available(0));
+  if (!counters.valid()) {
+    GTEST_SKIP() << "perf_event_open not permitted";
+  }
+  EXPECT_TRUE(counters.available(1));
+  counters.start();
+  auto sample = counters.read();
+  EXPECT_EQ(sample.values[0], 0);
+  EXPECT_GT(sample.values[1], 0);
+}
+
+TEST(PerfCountersTest, nothing_available_reads_zero) {
+  perf_counters counters({{PERF_TYPE_MAX + 1, 0, "invalid"}});
+  EXPECT_FALSE(counters.valid());
+  counters.start();
+  counters.stop();
+  auto sample = counters.read();
+  EXPECT_EQ(sample.values[0], 0);
+}
+
+} // namespace
@@ -96,4 +96,86 @@ TEST_F(WaitNotifyTest, aggregate_signals) {
   EXPECT_EQ(waitable.count(), 2);
 }
 
+TEST_F(WaitNotifyTest, notify_parked_waiter) {
+  signal_t signal = 73;
+  Waitable parking(state, 0);
+  std::thread t(wait, std::ref(parking), signal);
+
+  // no spinning, the waiter goes to sleep in the kernel
+  while (state.parked() == 0)
+    ;
+
+  notifier.notify(signal);
+  t.join();
+  EXPECT_EQ(state.parked(), 0);
+}
+
+TEST_F(WaitNotifyTest, notify_spinning_waiter) {
+  signal_t signal = 73;
+  // spins much longer than it takes to notify
+  Waitable spinning(state, 1 << 30);
+  std::thread t(wait, std::ref(spinning), signal);
+
+  notifier.notify(signal);
+  t.join();
+  EXPECT_EQ(state.parked(), 0);
+  EXPECT_EQ(spinning.count(), 1);
+}
+
+TEST_F(WaitNotifyTest, spin_is_configurable) {
+  Waitable waitable(state, 4);
+  EXPECT_EQ(waitable.spin(), 4);
+  waitable.set_spin(0);
+  EXPECT_EQ(waitable.spin(), 0);
+}
+
+TEST_F(WaitNotifyTest, wait_for_times_out) {
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(waitable.wait_for(std::chrono::milliseconds(20)),
+            WaitState::WAITING);
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20));
+  EXPECT_EQ(state.parked(), 0);
+}
+
+TEST_F(WaitNotifyTest, wait_until_notified) {
+  signal_t signal = 73;
+  std::thread t([&]() {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    EXPECT_EQ(waitable.wait_until(deadline), signal);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  notifier.notify(signal);
+  t.join();
+}
+
+TEST_F(WaitNotifyTest, wait_for_signal_before_wait) {
+  notifier.notify(5);
+  EXPECT_EQ(waitable.wait_for(std::chrono::milliseconds(0)), 5);
+}
+
+TEST_F(WaitNotifyTest, ping_pong) {
+  constexpr int rounds = 1000;
+  WaitState back;
+  Notifier pong(back);
+  Waitable wait_pong(back);
+
+  std::thread t([&]() {
+    for (int i = 0; i < rounds; ++i) {
+      EXPECT_EQ(waitable.wait(), 1);
+      pong.notify();
+    }
+  });
+
+  for (int i = 0; i < rounds; ++i) {
+    notifier.notify();
+    EXPECT_EQ(wait_pong.wait(), 1);
+  }
+  t.join();
+  EXPECT_EQ(waitable.count(), rounds);
+  EXPECT_EQ(wait_pong.count(), rounds);
+}
+
 } // namespace
\ No newline at end of file
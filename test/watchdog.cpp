@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include "monitoring/watchdog.hpp"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+using namespace monitor;
+
+checkpoint_index_t site_index() {
+  DEFINE_CHECKPOINT_SITE(site);
+  return site::index();
+}
+
+monitor::time_t now() { return to_time_unit(monitor::clock_t::now()); }
+
+class WatchdogTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    name = std::string(WATCHDOG_SEGMENT_PREFIX) + "test." +
+           std::to_string(getpid());
+  }
+
+  virtual void TearDown() { shared_segment::remove(name); }
+
+  std::string name;
+};
+
+TEST_F(WatchdogTest, segment_contains_sites) {
+  auto segment = shared_segment::create(name, 4);
+  ASSERT_TRUE(segment);
+  EXPECT_EQ(segment->header().pid, getpid());
+  EXPECT_EQ(segment->max_threads(), 4);
+
+  auto site = segment->site(site_index());
+  ASSERT_NE(site, nullptr);
+  EXPECT_STREQ(site->file, __FILE__);
+  EXPECT_STREQ(site->function, "site_index");
+  EXPECT_EQ(segment->site(UNREGISTERED_CHECKPOINT), nullptr);
+
+  auto reader = shared_segment::open(name);
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(reader->header().site_count, checkpoint_registry::count());
+}
+
+TEST_F(WatchdogTest, limited_slots) {
+  auto segment = shared_segment::create(name, 2);
+  ASSERT_TRUE(segment);
+  auto first = segment->claim(1);
+  EXPECT_NE(first, nullptr);
+  EXPECT_NE(segment->claim(2), nullptr);
+  EXPECT_EQ(segment->claim(3), nullptr);
+  first->release();
+  EXPECT_EQ(segment->claim(3), first);
+}
+
+TEST_F(WatchdogTest, violation_reported_once) {
+  auto segment = shared_segment::create(name, 4);
+  ASSERT_TRUE(segment);
+  auto slot = segment->claim(this_os_tid());
+
+  watchdog sut;
+  ASSERT_TRUE(sut.watch(name));
+  EXPECT_FALSE(sut.watch(name));
+
+  auto t = now();
+  // the outer checkpoint is due first
+  slot->push(1, t - 1000, t - 1000, 42, site_index());
+  slot->push(2, t + 1000000000, t - 1000, 43, UNREGISTERED_CHECKPOINT);
+
+  auto violations = sut.check(t);
+  ASSERT_EQ(violations.size(), 1);
+  auto &v = violations[0];
+  EXPECT_EQ(v.pid, getpid());
+  EXPECT_EQ(v.os_tid, this_os_tid());
+  EXPECT_EQ(v.id, 42);
+  EXPECT_EQ(v.level, 0);
+  EXPECT_EQ(v.delta, 1000);
+  EXPECT_EQ(v.function, "site_index");
+
+  EXPECT_TRUE(sut.check(t + 1).empty());
+
+  // a new checkpoint on the same level
+  slot->pop(1, t - 1000);
+  slot->pop(0, 0);
+  slot->push(1, t + 10, t + 10, 44, UNREGISTERED_CHECKPOINT);
+  EXPECT_TRUE(sut.check(t).empty());
+  violations = sut.check(t + 20);
+  ASSERT_EQ(violations.size(), 1);
+  EXPECT_EQ(violations[0].id, 44);
+  EXPECT_TRUE(violations[0].file.empty());
+}
+
+TEST_F(WatchdogTest, deep_nesting) {
+  auto segment = shared_segment::create(name, 1);
+  auto slot = segment->claim(this_os_tid());
+  auto t = now();
+  for (uint32_t depth = 1; depth <= WATCHDOG_MAX_DEPTH + 2; ++depth) {
+    slot->push(depth, t - depth, t - depth, depth, UNREGISTERED_CHECKPOINT);
+  }
+
+  watchdog sut;
+  ASSERT_TRUE(sut.watch(name));
+  // the mirrored levels and the earliest deadline of the deeper ones
+  auto violations = sut.check(t);
+  ASSERT_EQ(violations.size(), WATCHDOG_MAX_DEPTH + 1);
+  auto &deep = violations.back();
+  EXPECT_EQ(deep.level, WATCHDOG_MAX_DEPTH + 1);
+  EXPECT_EQ(deep.id, 0);
+  EXPECT_TRUE(deep.file.empty());
+  EXPECT_EQ(deep.delta, WATCHDOG_MAX_DEPTH + 2);
+  // reported once
+  EXPECT_TRUE(sut.check(t).empty());
+}
+
+TEST_F(WatchdogTest, deep_nesting_inner_deadline) {
+  auto segment = shared_segment::create(name, 1);
+  auto slot = segment->claim(this_os_tid());
+  auto t = now();
+  for (uint32_t depth = 1; depth <= WATCHDOG_MAX_DEPTH; ++depth) {
+    slot->push(depth, t + 1000000, t + 1000000, depth,
+               UNREGISTERED_CHECKPOINT);
+  }
+  // a tighter deadline beyond the mirrored levels
+  slot->push(WATCHDOG_MAX_DEPTH + 1, t + 10, t + 10, 42,
+             UNREGISTERED_CHECKPOINT);
+
+  watchdog sut;
+  ASSERT_TRUE(sut.watch(name));
+  EXPECT_TRUE(sut.check(t).empty());
+  auto violations = sut.check(t + 20);
+  ASSERT_EQ(violations.size(), 1);
+  EXPECT_EQ(violations[0].level, WATCHDOG_MAX_DEPTH);
+  EXPECT_EQ(violations[0].delta, 10);
+}
+
+TEST_F(WatchdogTest, stalled_process) {
+  int ready[2];
+  ASSERT_EQ(pipe(ready), 0);
+
+  auto pid = fork();
+  if (pid == 0) {
+    auto segment = shared_segment::create(name, 4);
+    auto slot = segment->claim(this_os_tid());
+    auto t = now();
+    slot->push(1, t + 1000000, t + 1000000, 7, site_index());
+    char c = 1;
+    (void)!write(ready[1], &c, 1);
+    // the whole process hangs
+    while (true) {
+      pause();
+    }
+  }
+
+  char c;
+  ASSERT_EQ(read(ready[0], &c, 1), 1);
+  watchdog sut;
+  ASSERT_TRUE(sut.watch(name));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  auto violations = sut.check();
+  ASSERT_EQ(violations.size(), 1);
+  EXPECT_EQ(violations[0].pid, pid);
+  EXPECT_EQ(violations[0].id, 7);
+  EXPECT_TRUE(sut.reap().empty());
+
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+  auto reaped = sut.reap();
+  ASSERT_EQ(reaped.size(), 1);
+  EXPECT_EQ(reaped[0], pid);
+  EXPECT_EQ(sut.size(), 0);
+  EXPECT_FALSE(shared_segment::open(name));
+  close(ready[0]);
+  close(ready[1]);
+}
+
+TEST_F(WatchdogTest, discover) {
+  auto segment = shared_segment::create(name, 1);
+  watchdog sut;
+  EXPECT_GE(sut.discover(), 1);
+  EXPECT_EQ(sut.discover(), 0);
+}
+
+} // namespace
@@ -0,0 +1,53 @@
+#include "monitoring/watchdog.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// out-of-process watchdog, checks the deadlines of all processes that
+// export their monitoring state (monitor::export_to_watchdog)
+//
+// usage: watchdog [interval in ms] [segment names...]
+// without names all segments with the default prefix are watched
+// (including those of processes started later)
+
+using namespace std::chrono_literals;
+
+int main(int argc, char **argv) {
+  auto interval = 10ms;
+  if (argc > 1 && std::atoi(argv[1]) > 0) {
+    interval = std::chrono::milliseconds(std::atoi(argv[1]));
+  }
+
+  monitor::watchdog watchdog;
+  bool discover = argc <= 2;
+  for (int i = 2; i < argc; ++i) {
+    if (!watchdog.watch(argv[i])) {
+      std::cerr << "WATCHDOG ERROR - cannot open segment " << argv[i]
+                << std::endl;
+    }
+  }
+
+  auto next_discovery = std::chrono::steady_clock::now();
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+    if (discover && now >= next_discovery) {
+      watchdog.discover();
+      next_discovery = now + 1s;
+    }
+
+    for (auto &v : watchdog.check()) {
+      std::cout << v << std::endl;
+    }
+
+    for (auto pid : watchdog.reap()) {
+      std::cout << "process " << pid << " terminated" << std::endl;
+    }
+
+    std::this_thread::sleep_for(interval);
+  }
+
+  return 0;
+}